@@ -31,7 +31,7 @@ public:
             auto options = vsg::Options::create(*runtime.readerWriterOptions);
             auto extension = std::filesystem::path(uri.full()).extension();
             options->extensionHint = extension.empty() ? result.value.contentType : extension;
-            std::stringstream in(result.value.data);
+            ByteBufferStream in(result.value.data);
             auto model = vsg::read_cast<vsg::Node>(in, options);
 
             if (model)
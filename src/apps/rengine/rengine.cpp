@@ -83,8 +83,8 @@ int main(int argc, char** argv)
     rocky::Log::info() << "Welcome to " << ROCKY_PROJECT_NAME << " version " << ROCKY_VERSION_STRING << std::endl;
     rocky::Log::info() << "Using VSG " << VSG_VERSION_STRING << " (so " << VSG_SOVERSION_STRING << ")" << std::endl;
 
-    // An LRU cache mainly used for network data fetches.
-    ri.ioOptions().services().contentCache->setCapacity(128);
+    // An LRU cache mainly used for network data fetches, limited in bytes.
+    ri.ioOptions().services().contentCache->setBudget(64u * 1024u * 1024u);
 
     // main window
     auto traits = vsg::WindowTraits::create(ROCKY_PROJECT_NAME);
@@ -0,0 +1,484 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+
+/**
+* RSEED generates the tiles of a map ahead of time and stores them in a
+* persistent cache or in MBTiles databases, so the map can be used later
+* without a network connection.
+*
+* Examples:
+*   rseed --map map.json --cache ./cache --max-level 8
+*   rseed --earthfile world.earth --mbtiles ./out --extent -10 35 30 60 --min-level 2 --max-level 12
+*
+* Tiles are generated in the map's profile, which is what the terrain engine
+* requests at runtime. Finished tiles are appended to a journal file in the
+* output folder once they are safely stored; running the same command again
+* skips the tiles listed there, so an interrupted run picks up where it left
+* off. Use --restart to ignore it.
+*/
+
+#include <rocky/Instance.h>
+#include <rocky/Map.h>
+#include <rocky/ImageLayer.h>
+#include <rocky/ElevationLayer.h>
+#include <rocky/FileCache.h>
+#include <rocky/Threading.h>
+#include <rocky/json.h>
+#include <rocky/contrib/EarthFileImporter.h>
+
+#ifdef ROCKY_SUPPORTS_MBTILES
+#include <rocky/MBTilesImageLayer.h>
+#include <rocky/MBTilesElevationLayer.h>
+#endif
+
+#include <rocky_vsg/InstanceVSG.h>
+
+#include <vsg/all.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+using namespace ROCKY_NAMESPACE;
+
+int usage(const char* msg)
+{
+    std::cout
+        << msg << std::endl
+        << "Usage: rseed (--map <file.json> | --earthfile <file.earth>) (--cache <folder> | --mbtiles <folder>)" << std::endl
+        << "    [--min-level <n>]               first level to generate (default 0)" << std::endl
+        << "    [--max-level <n>]               last level to generate (default 6)" << std::endl
+        << "    [--extent <w> <s> <e> <n>]      area to generate, in degrees (default everything)" << std::endl
+        << "    [--layer <name>]                only generate this layer (repeatable)" << std::endl
+        << "    [--threads <n>]                 number of tiles to generate at once" << std::endl
+        << "    [--restart]                     ignore the journal of a previous run" << std::endl;
+    return -1;
+}
+
+namespace
+{
+    //! One layer to seed, and where to put its tiles
+    struct Target
+    {
+        shared_ptr<ImageLayer> image;
+        shared_ptr<ElevationLayer> elevation;
+        shared_ptr<ImageLayer> imageOutput;         // MBTiles output, or null to just fill the cache
+        shared_ptr<ElevationLayer> elevationOutput; // MBTiles output, or null to just fill the cache
+        std::function<Status()> flush;              // commits batched output writes
+
+        const std::string& name() const {
+            return image ? image->name() : elevation->name();
+        }
+    };
+
+    //! Record of finished tiles, so an interrupted run can resume
+    class Journal
+    {
+    public:
+        Journal(const std::filesystem::path& path, bool restart)
+        {
+            if (!restart)
+            {
+                std::ifstream in(path);
+                std::string line;
+                while (std::getline(in, line))
+                {
+                    if (!line.empty())
+                        _done.insert(line);
+                }
+            }
+            _out.open(path, restart ? std::ios_base::trunc : std::ios_base::app);
+        }
+
+        bool ok() const {
+            return _out.is_open();
+        }
+
+        std::size_t size() const {
+            return _done.size();
+        }
+
+        bool contains(const Target& target, const TileKey& key) const {
+            return _done.count(entry(target, key)) > 0;
+        }
+
+        //! Note a finished tile; it's recorded at the next commit
+        void add(const Target& target, const TileKey& key)
+        {
+            std::scoped_lock lock(_mutex);
+            _pending.push_back(entry(target, key));
+        }
+
+        //! Flush the outputs, then record every tile finished before the call
+        void commit(const std::vector<Target>& targets)
+        {
+            std::vector<std::string> entries;
+            {
+                std::scoped_lock lock(_mutex);
+                entries.swap(_pending);
+            }
+
+            // tiles in batched outputs are not safe until committed
+            for (auto& target : targets)
+            {
+                if (target.flush && target.flush().failed())
+                {
+                    Log::warn() << "Failed to commit tiles for layer \"" << target.name() << "\"" << std::endl;
+                    return;
+                }
+            }
+
+            for (auto& e : entries)
+                _out << e << '\n';
+            _out.flush();
+        }
+
+    private:
+        std::unordered_set<std::string> _done;
+        std::vector<std::string> _pending;
+        std::ofstream _out;
+        std::mutex _mutex;
+
+        static std::string entry(const Target& target, const TileKey& key) {
+            return target.name() + '\t' + key.str();
+        }
+    };
+
+    //! Running totals
+    struct Counters
+    {
+        std::atomic<std::uint64_t> tiles = { 0 };   // tiles processed
+        std::atomic<std::uint64_t> empty = { 0 };   // tiles with no data
+        std::atomic<std::uint64_t> errors = { 0 };  // tiles that failed; retried on the next run
+        std::atomic<std::uint64_t> bytes = { 0 };   // uncompressed bytes of tile data generated
+    };
+
+    //! Generates one tile and stores it. Returns false if it should be tried again later.
+    bool seed(const Target& target, const TileKey& key, const IOOptions& io, Counters& counters)
+    {
+        Status status;
+        bool have_data = false;
+
+        // Creating the tile writes it to the persistent cache, if there is one.
+        if (target.image)
+        {
+            auto r = target.image->createImage(key, io);
+            status = r.status;
+            if (r.status.ok() && r.value.valid())
+            {
+                have_data = true;
+                counters.bytes += r.value.image()->sizeInBytes();
+                if (target.imageOutput)
+                    status = target.imageOutput->writeImage(key, r.value.image(), io);
+            }
+        }
+        else
+        {
+            auto r = target.elevation->createHeightfield(key, io);
+            status = r.status;
+            if (r.status.ok() && r.value.valid())
+            {
+                have_data = true;
+                counters.bytes += r.value.heightfield()->sizeInBytes();
+                if (target.elevationOutput)
+                    status = target.elevationOutput->writeHeightfield(key, r.value.heightfield(), io);
+            }
+        }
+
+        counters.tiles++;
+
+        // no data here is a legitimate answer
+        if (!have_data && (status.ok() || status.code == Status::ResourceUnavailable))
+        {
+            counters.empty++;
+            return true;
+        }
+
+        if (status.failed())
+        {
+            counters.errors++;
+            Log::warn() << "Layer \"" << target.name() << "\" tile " << key.str() << ": " << status.message << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string megabytes(double bytes)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << bytes / 1048576.0 << " MB";
+        return out.str();
+    }
+
+    //! Prints throughput since the start of the run
+    void report(const Counters& counters, std::uint64_t total, const NetworkStats& network,
+        std::uint64_t network_start, double seconds)
+    {
+        auto tiles = counters.tiles.load();
+        auto bytes = counters.bytes.load();
+        auto net = network.bytesTransferred.load() - network_start;
+        seconds = std::max(seconds, 0.001);
+
+        Log::info()
+            << tiles << "/" << total << " tiles"
+            << " (" << std::fixed << std::setprecision(1) << (double)tiles / seconds << " tiles/s)"
+            << ", generated " << megabytes((double)bytes) << " (" << megabytes((double)bytes / seconds) << "/s)"
+            << ", downloaded " << megabytes((double)net) << " (" << megabytes((double)net / seconds) << "/s)"
+            << ", " << counters.empty.load() << " empty, " << counters.errors.load() << " errors"
+            << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    vsg::CommandLine arguments(&argc, argv);
+    if (arguments.read({ "--help" }))
+        return usage(argv[0]);
+
+    // Instance installs the image readers (and writers) we need
+    rocky::InstanceVSG ri(arguments);
+    rocky::Log::level = rocky::LogLevel::INFO;
+
+    std::string mapfile, earthfile, cachePath, mbtilesPath;
+    arguments.read({ "--map" }, mapfile);
+    arguments.read({ "--earthfile" }, earthfile);
+    arguments.read({ "--cache" }, cachePath);
+    arguments.read({ "--mbtiles" }, mbtilesPath);
+
+    if (mapfile.empty() == earthfile.empty())
+        return usage("Please specify one of --map or --earthfile");
+
+    if (cachePath.empty() == mbtilesPath.empty())
+        return usage("Please specify one of --cache or --mbtiles");
+
+#ifndef ROCKY_SUPPORTS_MBTILES
+    if (!mbtilesPath.empty())
+        return usage("MBTiles support is not available in this build");
+#endif
+
+    unsigned minLevel = 0u, maxLevel = 6u;
+    arguments.read({ "--min-level" }, minLevel);
+    arguments.read({ "--max-level" }, maxLevel);
+    if (minLevel > maxLevel)
+        return usage("--min-level is greater than --max-level");
+
+    double west, south, east, north;
+    bool useExtent = arguments.read({ "--extent" }, west, south, east, north);
+
+    std::set<std::string> layerNames;
+    std::string layerName;
+    while (arguments.read({ "--layer" }, layerName))
+        layerNames.insert(layerName);
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    arguments.read({ "--threads" }, threads);
+    threads = std::max(1u, threads);
+
+    bool restart = arguments.read({ "--restart" });
+
+    // the output goes in a folder either way, along with the journal.
+    std::filesystem::path outputFolder(cachePath.empty() ? mbtilesPath : cachePath);
+    std::error_code ec;
+    std::filesystem::create_directories(outputFolder, ec);
+    if (ec)
+        return usage(("Cannot create output folder: " + ec.message()).c_str());
+
+    // Install the persistent cache before any layers open.
+    if (!cachePath.empty())
+    {
+        auto cache = FileCache::create(cachePath);
+        ri.ioOptions().services().cache = [cache]() { return cache; };
+    }
+
+    // Load the map.
+    auto map = Map::create(ri);
+
+    if (!mapfile.empty())
+    {
+        JSON json;
+        if (!util::readFromFile(json, mapfile))
+            return usage(("Failed to read map from \"" + mapfile + "\"").c_str());
+        map->from_json(json);
+    }
+    else
+    {
+        EarthFileImporter importer;
+        auto result = importer.read(earthfile, ri.ioOptions());
+        if (result.status.failed())
+            return usage(("Failed to read earth file - " + result.status.message).c_str());
+        map->from_json(result.value);
+    }
+
+    const Profile& profile = map->profile();
+
+    // Pick the layers to seed.
+    std::vector<Target> targets;
+    for (auto& layer : map->layers().ofType<TileLayer>())
+    {
+        if (!layerNames.empty() && layerNames.count(layer->name()) == 0)
+            continue;
+
+        if (layer->status().failed())
+        {
+            Log::warn() << "Skipping layer \"" << layer->name() << "\": " << layer->status().message << std::endl;
+            continue;
+        }
+
+        Target target;
+        target.image = std::dynamic_pointer_cast<ImageLayer>(layer);
+        target.elevation = std::dynamic_pointer_cast<ElevationLayer>(layer);
+        if (!target.image && !target.elevation)
+            continue;
+
+#ifdef ROCKY_SUPPORTS_MBTILES
+        if (!mbtilesPath.empty())
+        {
+            auto uri = URI((outputFolder / (layer->name() + ".mbtiles")).string());
+            shared_ptr<TileLayer> output;
+
+            if (target.image)
+            {
+                auto mbtiles = MBTilesImageLayer::create();
+                mbtiles->setURI(uri);
+                mbtiles->setBatchSize(256u);
+                target.imageOutput = mbtiles;
+                target.flush = [mbtiles]() { return mbtiles->flush(); };
+                output = mbtiles;
+            }
+            else
+            {
+                auto mbtiles = MBTilesElevationLayer::create();
+                mbtiles->setURI(uri);
+                mbtiles->setBatchSize(256u);
+                mbtiles->setFormat(RAW_IMAGE_CONTENT_TYPE); // keeps the floating point heights intact
+                target.elevationOutput = mbtiles;
+                target.flush = [mbtiles]() { return mbtiles->flush(); };
+                output = mbtiles;
+            }
+
+            output->setName(layer->name());
+            output->setProfile(profile);
+            if (output->openForWriting().failed())
+            {
+                Log::warn() << "Cannot write \"" << uri.full() << "\": " << output->status().message << std::endl;
+                continue;
+            }
+        }
+#endif
+
+        targets.push_back(target);
+    }
+
+    if (targets.empty())
+        return usage("No layers to seed");
+
+    Journal journal(outputFolder / "rseed.journal", restart);
+    if (!journal.ok())
+        return usage("Cannot write the journal file in the output folder");
+
+    if (journal.size() > 0)
+        Log::info() << "Resuming; " << journal.size() << " tiles already done" << std::endl;
+
+    GeoExtent extent;
+    if (useExtent)
+        extent = GeoExtent(SRS::WGS84, west, south, east, north);
+
+    auto& io = ri.ioOptions();
+    auto& network = *io.services().networkStats;
+    auto networkStart = network.bytesTransferred.load();
+
+    util::job_scheduler::setConcurrency("rocky.seed", threads);
+    auto scheduler = util::job_scheduler::get("rocky.seed");
+
+    Counters counters;
+    std::uint64_t totalTiles = 0u;
+    auto start = std::chrono::steady_clock::now();
+
+    // One level at a time, so the coarse levels are complete first.
+    for (unsigned lod = minLevel; lod <= maxLevel; ++lod)
+    {
+        std::vector<TileKey> keys;
+        if (useExtent)
+            TileKey::getIntersectingKeys(extent, lod, profile, keys);
+        else
+            Profile::getAllKeysAtLOD(lod, profile, keys);
+
+        // everything this level, less what the journal says is done
+        std::vector<std::pair<const Target*, TileKey>> work;
+        work.reserve(keys.size() * targets.size());
+        for (auto& key : keys)
+        {
+            for (auto& target : targets)
+            {
+                if (!journal.contains(target, key))
+                    work.emplace_back(&target, key);
+            }
+        }
+
+        totalTiles += work.size();
+        Log::info() << "Level " << lod << ": " << work.size() << " tiles to generate" << std::endl;
+
+        // A fixed set of workers pulls from the list, rather than a job per tile,
+        // which keeps memory flat no matter how many tiles there are.
+        std::atomic<std::size_t> next = { 0u };
+        util::job_group group;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            util::job::dispatch([&](Cancelable&)
+                {
+                    for (auto i = next++; i < work.size(); i = next++)
+                    {
+                        auto& [target, key] = work[i];
+                        if (seed(*target, key, io, counters))
+                            journal.add(*target, key);
+                    }
+                    return true;
+                }, { "rseed", nullptr, scheduler, &group });
+        }
+
+        // report progress and update the journal while the workers run
+        auto last_report = std::chrono::steady_clock::now();
+        auto last_commit = last_report;
+        while (counters.tiles.load() < totalTiles)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_commit >= std::chrono::seconds(1))
+            {
+                journal.commit(targets);
+                last_commit = now;
+            }
+            if (now - last_report >= std::chrono::seconds(5))
+            {
+                report(counters, totalTiles, network, networkStart, std::chrono::duration<double>(now - start).count());
+                last_report = now;
+            }
+        }
+
+        group.join();
+        journal.commit(targets);
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Log::info() << "Done in " << std::fixed << std::setprecision(1) << seconds << "s:" << std::endl;
+    report(counters, totalTiles, network, networkStart, seconds);
+
+    for (auto& target : targets)
+    {
+        if (target.imageOutput) target.imageOutput->close();
+        if (target.elevationOutput) target.elevationOutput->close();
+    }
+
+    // non-zero exit if anything needs another run
+    return counters.errors.load() > 0 ? 1 : 0;
+}
@@ -6,6 +6,7 @@
 #include "ElevationLayer.h"
 #include "Geoid.h"
 #include "Heightfield.h"
+#include "IOTrace.h"
 #include "Metrics.h"
 #include "json.h"
 
@@ -82,7 +83,7 @@ ElevationLayer::construct(const JSON& conf)
         _l2cachesize.set_default(32u);
     }
 
-    _L2cache.setCapacity(_l2cachesize.value());
+    _L2cache.setBudget(_l2cachesize.value());
 
     // Disable max-level support for elevation data because it makes no sense.
     _maxLevel.clear();
@@ -300,15 +301,23 @@ ElevationLayer::assembleHeightfield(const TileKey& key, const IOOptions& io) con
             if (xform.valid())
                 xform.transformArray(&points[0], points.size());
 
-            // sample the heights:
-            for (unsigned k = 0; k < geohf_list.size(); ++k)
-            {
-                for (auto& point : points)
+            // sample the heights, rows in parallel, taking the first valid height
+            // in resolution order:
+            bool sampled = util::parallel_for(0u, height, [&](unsigned r)
                 {
-                    if (point.z == NO_DATA_VALUE)
-                        point.z = geohf_list[k].heightAtLocation(point.x, point.y, Image::BILINEAR);
-                }
-            }
+                    for (unsigned k = 0; k < geohf_list.size(); ++k)
+                    {
+                        for (unsigned c = 0; c < width; ++c)
+                        {
+                            auto& point = points[r * width + c];
+                            if (point.z == NO_DATA_VALUE)
+                                point.z = geohf_list[k].heightAtLocation(point.x, point.y, Image::BILINEAR);
+                        }
+                    }
+                }, &io);
+
+            if (!sampled)
+                return nullptr;
 
             // transform the elevations back to the SRS of our tilekey (vdatum transform):
             if (xform.valid())
@@ -351,7 +360,31 @@ ElevationLayer::createHeightfield(
         return Result(GeoHeightfield::INVALID);
     }
 
-    return createHeightfieldInKeyProfile(key, io);
+    IOTracer::Scope trace(io, name(), key.str());
+
+    // Recently created tiles (e.g. neighbors sampled for normal maps)
+    auto cached = _L2cache.find(key);
+    if (cached)
+    {
+        if (auto* record = IOTracer::current())
+            record->cacheHits++;
+
+        return *cached;
+    }
+
+    // Share the result with any other callers asking for the same key
+    // while this request is in flight.
+    auto result = _inflight.get(key, [&]()
+        {
+            return createHeightfieldInKeyProfile(key, io);
+        }, &io);
+
+    if (result.status.ok() && result.value.valid() && !io.canceled())
+    {
+        _L2cache.put(key, result.value);
+    }
+
+    return result;
 }
 
 Result<GeoHeightfield>
@@ -374,6 +407,17 @@ ElevationLayer::createHeightfieldInKeyProfile(
         return Result(GeoHeightfield::INVALID);
     }
 
+    // check the persistent cache first.
+    auto cached = readTileFromCache(key, io);
+    if (cached.status.ok() && cached.value->pixelFormat() == Image::R32_SFLOAT)
+    {
+        return GeoHeightfield(Heightfield::create(cached.value.get()), key.extent());
+    }
+    else if (isCacheOnly())
+    {
+        return Result(GeoHeightfield::INVALID);
+    }
+
     if (key.profile() == my_profile)
     {
         std::shared_lock L(layerStateMutex());
@@ -418,6 +462,12 @@ ElevationLayer::createHeightfieldInKeyProfile(
 
     result = GeoHeightfield(hf, key.extent());
 
+    // a canceled request may have left the heightfield partly assembled
+    if (!io.canceled())
+    {
+        writeTileToCache(key, hf, io);
+    }
+
     return result;
 }
 
@@ -887,22 +937,22 @@ ElevationLayer::decodeMapboxRGB(shared_ptr<Image> image) const
     // convert the RGB Elevation into an actual heightfield
     auto hf = Heightfield::create(image->width(), image->height());
 
-    glm::fvec4 pixel;
-    for (unsigned y = 0; y < image->height(); ++y)
-    {
-        for (unsigned x = 0; x < image->width(); ++x)
+    util::parallel_for(0u, image->height(), [&](unsigned y)
         {
-            image->read(pixel, x, y);
+            glm::fvec4 pixel;
+            for (unsigned x = 0; x < image->width(); ++x)
+            {
+                image->read(pixel, x, y);
 
-            float height = -10000.f +
-                ((pixel.r * 256.0f * 256.0f + pixel.g * 256.0f + pixel.b) * 256.0f * 0.1f);
+                float height = -10000.f +
+                    ((pixel.r * 256.0f * 256.0f + pixel.g * 256.0f + pixel.b) * 256.0f * 0.1f);
 
-            if (height < -9999 || height > 999999)
-                height = NO_DATA_VALUE;
+                if (height < -9999 || height > 999999)
+                    height = NO_DATA_VALUE;
 
-            hf->heightAt(x, y) = height;
-        }
-    }
+                hf->heightAt(x, y) = height;
+            }
+        });
 
     return hf;
 }
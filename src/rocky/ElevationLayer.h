@@ -63,7 +63,8 @@ namespace ROCKY_NAMESPACE
         /**
          * Creates a GeoHeightField for this layer that corresponds to the extents and LOD
          * in the specified TileKey. The returned HeightField will always match the geospatial
-         * extents of that TileKey.
+         * extents of that TileKey. Simultaneous and recent requests for the same
+         * key share one heightfield, so treat it as read-only (copy it to make changes).
          *
          * @param key TileKey for which to create a heightfield.
          * @param progress Callback for tracking progress and cancelation
@@ -130,9 +131,9 @@ namespace ROCKY_NAMESPACE
         void normalizeNoDataValues(
             Heightfield* hf) const;
 
-        util::Gate<TileKey> _sentry;
+        mutable util::Coalescer<TileKey, Result<GeoHeightfield>> _inflight;
 
-        mutable util::LRUCache<TileKey, Result<GeoHeightfield>> _L2cache;
+        mutable util::ShardedLRUCache<TileKey, GeoHeightfield> _L2cache{ 32u, nullptr, 4u };
     };
 
 
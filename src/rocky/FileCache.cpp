@@ -0,0 +1,178 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "FileCache.h"
+#include "DateTime.h"
+#include "Utils.h"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace ROCKY_NAMESPACE;
+
+#define LC "[FileCache] "
+
+namespace
+{
+    // every record file starts with this, followed by the write time and a newline
+    const std::string RECORD_HEADER = "rocky.cache ";
+
+    // Turns a bin or key into a relative path that can't escape the cache folder.
+    // Slashes separate folders; anything unusual becomes an underscore.
+    std::filesystem::path sanitize(const std::string& input)
+    {
+        util::StringVector parts;
+        util::StringTokenizer tokenizer("/\\", "");
+        tokenizer.keepEmpties() = false;
+        tokenizer.tokenize(input, parts);
+
+        std::filesystem::path result;
+        for (auto& part : parts)
+        {
+            std::string clean = part;
+            for (auto& c : clean)
+            {
+                if (!std::isalnum((unsigned char)c) && c != '-' && c != '_' && c != '.')
+                    c = '_';
+            }
+            if (clean == "." || clean == "..")
+                clean = "_";
+            result /= clean;
+        }
+        return result;
+    }
+}
+
+FileCache::FileCache(const std::string& rootPath) :
+    _rootPath(rootPath)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_rootPath, ec);
+    if (ec)
+    {
+        Log::warn() << LC << "Cannot create cache folder \"" << _rootPath << "\": " << ec.message() << std::endl;
+    }
+}
+
+std::filesystem::path
+FileCache::pathTo(const std::string& bin, const std::string& key) const
+{
+    return std::filesystem::path(_rootPath) / sanitize(bin) / sanitize(key);
+}
+
+Result<Cache::Record>
+FileCache::read(const std::string& bin, const std::string& key) const
+{
+    std::ifstream in(pathTo(bin, key), std::ios_base::in | std::ios_base::binary);
+    if (!in.is_open())
+    {
+        return Result<Record>(Status::ResourceUnavailable, "Not in cache");
+    }
+
+    std::string header;
+    if (!std::getline(in, header) || !util::startsWith(header, RECORD_HEADER))
+    {
+        return Result<Record>(Status::GeneralError, "Corrupt cache record");
+    }
+
+    Record record;
+    record.lastModified = (TimeStamp)std::strtoll(header.c_str() + RECORD_HEADER.size(), nullptr, 10);
+
+    std::stringstream buf;
+    buf << in.rdbuf();
+    record.data = buf.str();
+
+    return record;
+}
+
+Result<TimeStamp>
+FileCache::stat(const std::string& bin, const std::string& key) const
+{
+    // the write time is in the header line, so there's no need to read the data
+    std::ifstream in(pathTo(bin, key), std::ios_base::in | std::ios_base::binary);
+    if (!in.is_open())
+    {
+        return Result<TimeStamp>(Status::ResourceUnavailable, "Not in cache");
+    }
+
+    std::string header;
+    if (!std::getline(in, header) || !util::startsWith(header, RECORD_HEADER))
+    {
+        return Result<TimeStamp>(Status::GeneralError, "Corrupt cache record");
+    }
+
+    return (TimeStamp)std::strtoll(header.c_str() + RECORD_HEADER.size(), nullptr, 10);
+}
+
+Status
+FileCache::write(const std::string& bin, const std::string& key, const std::string& data)
+{
+    static std::atomic<unsigned> s_counter = { 0u };
+
+    auto path = pathTo(bin, key);
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec)
+    {
+        return Status(Status::ResourceUnavailable, ec.message());
+    }
+
+    // write to a unique temporary file first, then move it into place in one step.
+    std::ostringstream suffix;
+    suffix << ".tmp" << std::hash<std::thread::id>()(std::this_thread::get_id()) << "_" << s_counter++;
+    auto temp = path;
+    temp += suffix.str();
+
+    {
+        std::ofstream out(temp, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        if (!out.is_open())
+        {
+            return Status(Status::ResourceUnavailable, "Cannot write to cache");
+        }
+
+        out << RECORD_HEADER << DateTime().asTimeStamp() << '\n';
+        out.write(data.data(), data.size());
+
+        if (!out.good())
+        {
+            out.close();
+            std::filesystem::remove(temp, ec);
+            return Status(Status::GeneralError, "Cache write failed");
+        }
+    }
+
+    std::filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return Status(Status::GeneralError, "Cache write failed");
+    }
+
+    return StatusOK;
+}
+
+Status
+FileCache::remove(const std::string& bin, const std::string& key)
+{
+    std::error_code ec;
+    std::filesystem::remove(pathTo(bin, key), ec);
+    return ec ? Status(Status::GeneralError, ec.message()) : StatusOK;
+}
+
+Status
+FileCache::clear(const std::string& bin)
+{
+    auto path = std::filesystem::path(_rootPath) / sanitize(bin);
+    if (path == std::filesystem::path(_rootPath))
+    {
+        return Status(Status::AssertionFailure, "Missing bin name");
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+    return ec ? Status(Status::GeneralError, ec.message()) : StatusOK;
+}
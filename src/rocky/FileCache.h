@@ -0,0 +1,51 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/IOTypes.h>
+#include <filesystem>
+
+namespace ROCKY_NAMESPACE
+{
+    /**
+     * Persistent cache that stores each record as a file in a folder tree,
+     * laid out as <root>/<bin>/<key>.
+     *
+     * Writes go to a temporary file that is then renamed into place, so a
+     * reader never sees a partial record and several processes can share
+     * the same cache folder.
+     *
+     * Usage:
+     *   auto cache = FileCache::create("/data/rocky_cache");
+     *   instance.ioOptions().services().cache = [cache]() { return cache; };
+     */
+    class ROCKY_EXPORT FileCache : public Inherit<Cache, FileCache>
+    {
+    public:
+        //! Construct a cache rooted at a folder, which is created if necessary
+        FileCache(const std::string& rootPath);
+
+        //! Folder holding the cache
+        const std::string& rootPath() const { return _rootPath; }
+
+    public: // Cache
+
+        Result<Record> read(const std::string& bin, const std::string& key) const override;
+
+        Result<TimeStamp> stat(const std::string& bin, const std::string& key) const override;
+
+        Status write(const std::string& bin, const std::string& key, const std::string& data) override;
+
+        Status remove(const std::string& bin, const std::string& key) override;
+
+        Status clear(const std::string& bin) override;
+
+    private:
+        std::string _rootPath;
+
+        std::filesystem::path pathTo(const std::string& bin, const std::string& key) const;
+    };
+}
@@ -5,10 +5,16 @@
  */
 #include "GDAL.h"
 #include "ElevationLayer.h" // for NO_DATA_VALUE
+#include "Threading.h"
 #include <gdal.h>
 #include <gdalwarper.h>
 #include <ogr_spatialref.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <filesystem>
+#include <limits>
+#include <map>
 
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::GDAL;
@@ -357,7 +363,32 @@ namespace ROCKY_NAMESPACE
             }
         }
 
-        // GDALRasterBand::RasterIO helper method
+#if GDAL_VERSION_2_0_OR_NEWER
+        // GDAL resampling algorithm for an interpolation method
+        GDALRIOResampleAlg resampleAlgorithm(Image::Interpolation interpolation)
+        {
+            switch (interpolation)
+            {
+            case Image::AVERAGE:
+                //return GRIORA_Average;
+                // for some reason gdal's average resampling produces artifacts occasionally for imagery at higher levels.
+                // for now we'll just use bilinear interpolation under the hood until we can understand what is going on.
+                return GRIORA_Bilinear;
+            case Image::BILINEAR:
+                return GRIORA_Bilinear;
+            case Image::CUBIC:
+                return GRIORA_Cubic;
+            case Image::CUBICSPLINE:
+                return GRIORA_CubicSpline;
+            default:
+                return GRIORA_NearestNeighbour;
+            }
+        }
+#endif
+
+        // GDALRasterBand::RasterIO helper method.
+        // "window" optionally gives the exact (fractional) window, within the integer one, to read.
+        // Values are scaled and offset by "valuesBand" (default: band) as they are read.
         bool rasterIO(
             GDALRasterBand *band,
             GDALRWFlag eRWFlag,
@@ -371,7 +402,9 @@ namespace ROCKY_NAMESPACE
             GDALDataType eBufType,
             GSpacing nPixelSpace,
             GSpacing nLineSpace,
-            Image::Interpolation interpolation = Image::NEAREST
+            Image::Interpolation interpolation = Image::NEAREST,
+            const double* window = nullptr,
+            GDALRasterBand* valuesBand = nullptr
         )
         {
 #if GDAL_VERSION_2_0_OR_NEWER
@@ -379,24 +412,15 @@ namespace ROCKY_NAMESPACE
 
             // defaults to GRIORA_NearestNeighbour
             INIT_RASTERIO_EXTRA_ARG(psExtraArg);
+            psExtraArg.eResampleAlg = resampleAlgorithm(interpolation);
 
-            switch (interpolation)
+            if (window)
             {
-            case Image::AVERAGE:
-                //psExtraArg.eResampleAlg = GRIORA_Average;
-                // for some reason gdal's average resampling produces artifacts occasionally for imagery at higher levels.
-                // for now we'll just use bilinear interpolation under the hood until we can understand what is going on.
-                psExtraArg.eResampleAlg = GRIORA_Bilinear;
-                break;
-            case Image::BILINEAR:
-                psExtraArg.eResampleAlg = GRIORA_Bilinear;
-                break;
-            case Image::CUBIC:
-                psExtraArg.eResampleAlg = GRIORA_Cubic;
-                break;
-            case Image::CUBICSPLINE:
-                psExtraArg.eResampleAlg = GRIORA_CubicSpline;
-                break;
+                psExtraArg.bFloatingPointWindowValidity = TRUE;
+                psExtraArg.dfXOff = window[0];
+                psExtraArg.dfYOff = window[1];
+                psExtraArg.dfXSize = window[2];
+                psExtraArg.dfYSize = window[3];
             }
 
             CPLErr err = band->RasterIO(eRWFlag, nXOff, nYOff, nXSize, nYSize, pData, nBufXSize, nBufYSize, eBufType, nPixelSpace, nLineSpace, &psExtraArg);
@@ -413,8 +437,8 @@ namespace ROCKY_NAMESPACE
             }
             else
             {
-                double scale = band->GetScale();
-                double offset = band->GetOffset();
+                double scale = (valuesBand ? valuesBand : band)->GetScale();
+                double offset = (valuesBand ? valuesBand : band)->GetOffset();
 
                 if (scale != 1.0 || offset != 0.0)
                 {
@@ -530,6 +554,78 @@ namespace ROCKY_NAMESPACE
 
 //...................................................................
 
+// Reduced copies of a dataset held in MEM datasets, each level half the size
+// of the one before. Drivers reading the same dataset share one set; GDAL
+// datasets aren't safe to read from two threads at once, so reads lock it.
+struct GDAL::Overviews
+{
+    std::mutex mutex;
+    bool built = false;
+    std::vector<GDALDataset*> levels;
+
+    ~Overviews()
+    {
+        for (auto level : levels)
+            GDALClose(level);
+    }
+};
+
+namespace
+{
+    // smallest reduction that makes an in-memory overview worth building
+    const double MIN_OVERVIEW_FACTOR = 4.0;
+
+    // most pixels (per band) in the largest in-memory overview
+    const double MAX_OVERVIEW_PIXELS = 4096.0 * 4096.0;
+
+    std::mutex s_overviewsMutex;
+    std::map<std::string, std::weak_ptr<GDAL::Overviews>> s_overviews;
+
+    // Finds the in-memory level with the largest reduction that doesn't exceed
+    // "factor", and maps the source window into its pixels: "window" gets the
+    // exact (fractional) window, and x/y/width/height the whole pixels covering it.
+    int selectLevel(
+        const std::vector<GDALDataset*>& levels,
+        int rasterWidth, int rasterHeight, double factor,
+        int& x, int& y, int& width, int& height, double window[4])
+    {
+        int best = -1;
+        double bestFactor = 1.0;
+        for (int i = 0; i < (int)levels.size(); ++i)
+        {
+            double f = std::min(
+                (double)rasterWidth / (double)levels[i]->GetRasterXSize(),
+                (double)rasterHeight / (double)levels[i]->GetRasterYSize());
+
+            if (f <= factor && f > bestFactor)
+            {
+                best = i;
+                bestFactor = f;
+            }
+        }
+
+        if (best >= 0)
+        {
+            int w = levels[best]->GetRasterXSize();
+            int h = levels[best]->GetRasterYSize();
+            double sx = (double)w / (double)rasterWidth;
+            double sy = (double)h / (double)rasterHeight;
+
+            window[0] = std::clamp((double)x * sx, 0.0, (double)w);
+            window[1] = std::clamp((double)y * sy, 0.0, (double)h);
+            window[2] = std::clamp((double)(x + width) * sx, window[0], (double)w) - window[0];
+            window[3] = std::clamp((double)(y + height) * sy, window[1], (double)h) - window[1];
+
+            int x0 = std::clamp((int)floor(window[0]), 0, w - 1);
+            int y0 = std::clamp((int)floor(window[1]), 0, h - 1);
+            int x1 = std::clamp((int)ceil(window[0] + window[2]), x0 + 1, w);
+            int y1 = std::clamp((int)ceil(window[1] + window[3]), y0 + 1, h);
+            x = x0, y = y0, width = x1 - x0, height = y1 - y0;
+        }
+        return best;
+    }
+}
+
 GDAL::Driver::Driver() :
     _srcDS(NULL),
     _warpedDS(NULL),
@@ -560,6 +656,7 @@ GDAL::Driver::open(
 
     _name = name;
     _layer = layer;
+    _tileSize = tileSize;
 
     // Is a valid external GDAL dataset specified ?
     bool useExternalDataset = false;
@@ -680,7 +777,7 @@ GDAL::Driver::open(
         auto rr = URI(prjLocation).read(io); // TODO io
         if (rr.status.ok() && !rr.value.data.empty())
         {
-            src_srs = SRS(util::trim(rr.value.data));
+            src_srs = SRS(util::trim(rr.value.data.str()));
         }
     }
 
@@ -760,6 +857,15 @@ GDAL::Driver::open(
         return Status("Failed to create a final sampling dataset");
     }
 
+    // drivers reading the same data the same way share in-memory overviews
+    std::stringstream key;
+    if (useExternalDataset)
+        key << "external:" << (void*)_srcDS;
+    else
+        key << source << ":" << layer->subDataSet().value();
+    key << "|" << warpedSRSWKT << "|" << _warpedDS->GetRasterXSize() << "x" << _warpedDS->GetRasterYSize();
+    _overviewsKey = key.str();
+
     // calcluate the inverse of the geotransform:
     GDALInvGeoTransform(_geotransform, _invtransform);
 
@@ -1236,13 +1342,13 @@ GDAL::Driver::createImage(
 
         memset(image->data<char>(), 0, image->sizeInBytes());
 
-        rasterIO(bandRed, GF_Read, off_x, off_y, width, height, red, target_width, target_height, GDT_Byte, 0, 0, _layer->interpolation());
-        rasterIO(bandGreen, GF_Read, off_x, off_y, width, height, green, target_width, target_height, GDT_Byte, 0, 0, _layer->interpolation());
-        rasterIO(bandBlue, GF_Read, off_x, off_y, width, height, blue, target_width, target_height, GDT_Byte, 0, 0, _layer->interpolation());
+        readWindow(bandRed, off_x, off_y, width, height, red, target_width, target_height, GDT_Byte, _layer->interpolation());
+        readWindow(bandGreen, off_x, off_y, width, height, green, target_width, target_height, GDT_Byte, _layer->interpolation());
+        readWindow(bandBlue, off_x, off_y, width, height, blue, target_width, target_height, GDT_Byte, _layer->interpolation());
 
         if (bandAlpha)
         {
-            rasterIO(bandAlpha, GF_Read, off_x, off_y, width, height, alpha, target_width, target_height, GDT_Byte, 0, 0, _layer->interpolation());
+            readWindow(bandAlpha, off_x, off_y, width, height, alpha, target_width, target_height, GDT_Byte, _layer->interpolation());
         }
 
         for (int src_row = 0, dst_row = tile_offset_top;
@@ -1306,7 +1412,7 @@ GDAL::Driver::createImage(
             {
                 short* temp = new short[target_width * target_height];
 
-                rasterIO(bandGray, GF_Read, off_x, off_y, width, height, temp, target_width, target_height, gdalDataType, 0, 0, _layer->interpolation());
+                readWindow(bandGray, off_x, off_y, width, height, temp, target_width, target_height, gdalDataType, _layer->interpolation());
 
                 int success = 0;
                 short noDataValueFromBand = bandGray->GetNoDataValue(&success);
@@ -1330,7 +1436,7 @@ GDAL::Driver::createImage(
             {
                 float* temp = new float[target_width * target_height];
 
-                rasterIO(bandGray, GF_Read, off_x, off_y, width, height, temp, target_width, target_height, gdalDataType, 0, 0, _layer->interpolation());
+                readWindow(bandGray, off_x, off_y, width, height, temp, target_width, target_height, gdalDataType, _layer->interpolation());
 
                 int success = 0;
                 float noDataValueFromBand = bandGray->GetNoDataValue(&success);
@@ -1367,12 +1473,12 @@ GDAL::Driver::createImage(
                 memset(alpha, 255, target_width * target_height);
             }
 
-            rasterIO(bandGray, GF_Read, off_x, off_y, width, height, gray, target_width, target_height, GDT_Byte, 0, 0, _layer->interpolation());
+            readWindow(bandGray, off_x, off_y, width, height, gray, target_width, target_height, GDT_Byte, _layer->interpolation());
 
             // color only:
             if (bandAlpha)
             {
-                rasterIO(bandAlpha, GF_Read, off_x, off_y, width, height, alpha, target_width, target_height, GDT_Byte, 0, 0, _layer->interpolation());
+                readWindow(bandAlpha, off_x, off_y, width, height, alpha, target_width, target_height, GDT_Byte, _layer->interpolation());
             }
 
             for (int src_row = 0, dst_row = tile_offset_top;
@@ -1436,14 +1542,13 @@ GDAL::Driver::createImage(
             memset(image->data<unsigned char>(), 0, image->sizeInBytes());
         }
 
-        rasterIO(
-            bandPalette, 
-            GF_Read,
+        readWindow(
+            bandPalette,
             off_x, off_y,
-            width, height, 
+            width, height,
             palette,
             target_width, target_height,
-            GDT_Byte, 0, 0, 
+            GDT_Byte,
             Image::NEAREST);
 
         //ImageUtils::PixelWriter write(image.get());
@@ -1521,7 +1626,6 @@ GDAL::Driver::createImage(
     return image;
 }
 
-#if 0
 Result<shared_ptr<Heightfield>>
 GDAL::Driver::createHeightfield(
     const TileKey& key,
@@ -1533,11 +1637,30 @@ GDAL::Driver::createHeightfield(
         return Status(Status::ResourceUnavailable);
     }
 
+    if (io.canceled())
+    {
+        return Status(Status::ResourceUnavailable);
+    }
+
     if (!intersects(key))
     {
         return Status(Status::ResourceUnavailable);
     }
 
+    // Try to find a FLOAT band
+    GDALRasterBand* band = findBandByDataType(_warpedDS, GDT_Float32);
+    if (band == NULL)
+    {
+        // Just get first band
+        band = _warpedDS->GetRasterBand(1);
+    }
+
+    // 8-bit data is imagery or RGB-encoded heights; createImage handles those
+    if (band->GetRasterDataType() == GDT_Byte)
+    {
+        return Status(Status::ConfigurationError, "Dataset does not contain elevation values");
+    }
+
     //Allocate the heightfield
     auto hf = Heightfield::create(tileSize, tileSize);
 
@@ -1545,12 +1668,19 @@ GDAL::Driver::createHeightfield(
     double xmin, ymin, xmax, ymax;
     key.extent().getBounds(xmin, ymin, xmax, ymax);
 
-    // Try to find a FLOAT band
-    GDALRasterBand* band = findBandByDataType(_warpedDS, GDT_Float32);
-    if (band == NULL)
+    // Move the tile into the longitude frame of the georeferencing (see createImage)
+    if (_extents.srs().isGeodetic())
     {
-        // Just get first band
-        band = _warpedDS->GetRasterBand(1);
+        while (xmax < _bounds.xmin)
+        {
+            xmin += 360.0;
+            xmax += 360.0;
+        }
+        while (xmin > _bounds.xmax)
+        {
+            xmin -= 360.0;
+            xmax -= 360.0;
+        }
     }
 
     if (_layer->interpolation() == Image::NEAREST)
@@ -1587,16 +1717,25 @@ GDAL::Driver::createHeightfield(
 
         rasterIO(band, GF_Read, iWinColMin, iWinRowMin, iNumWinCols, iNumWinRows, &buffer[startOffset], iNumBufCols, iNumBufRows, GDT_Float32, 0, lineSpace);
 
+        int success = 0;
+        float noDataValueFromBand = (float)band->GetNoDataValue(&success);
+        if (!success) noDataValueFromBand = -32767.0f;
+
         for (unsigned r = 0, ir = tileSize - 1; r < tileSize; ++r, --ir)
         {
             for (unsigned c = 0; c < tileSize; ++c)
             {
-                hf->heightAt(c, ir) = _linearUnits * buffer[r * tileSize + c];
+                // posts off the dataset are already NO_DATA_VALUE
+                float h = buffer[r * tileSize + c];
+                if (h != NO_DATA_VALUE)
+                    h = getValidElevationValue(h, noDataValueFromBand, NO_DATA_VALUE);
+                hf->heightAt(c, ir) = h == NO_DATA_VALUE ? h : h * (float)_linearUnits;
             }
         }
     }
-    else
+    else if (_invtransform[2] != 0.0 || _invtransform[4] != 0.0)
     {
+        // rotated dataset; sample post by post
         double dx = (xmax - xmin) / (tileSize - 1);
         double dy = (ymax - ymin) / (tileSize - 1);
         for (unsigned r = 0; r < tileSize; ++r)
@@ -1610,10 +1749,381 @@ GDAL::Driver::createHeightfield(
             }
         }
     }
+    else
+    {
+        Status status = sampleHeightfield(band, xmin, ymin, xmax, ymax, *hf);
+        if (status.failed())
+        {
+            return status;
+        }
+    }
 
     return hf;
 }
 
+float
+GDAL::Driver::heightAt(double x, double y)
+{
+    GDALRasterBand* band = findBandByDataType(_warpedDS, GDT_Float32);
+    if (band == NULL)
+    {
+        band = _warpedDS->GetRasterBand(1);
+    }
+
+    float h = getInterpolatedValue(band, x, y);
+    return h == NO_DATA_VALUE ? h : h * (float)_linearUnits;
+}
+
+Status
+GDAL::Driver::sampleHeightfield(GDALRasterBand* band, double xmin, double ymin, double xmax, double ymax, Heightfield& hf)
+{
+    // Reads the pixels under the tile with one RasterIO call and interpolates
+    // the posts in memory, instead of several single-pixel reads per post.
+    // Interpolation is separable (columns, then rows) since the dataset is north-up.
+
+    const int tileSize = (int)hf.width();
+    const int rasterWidth = _warpedDS->GetRasterXSize();
+    const int rasterHeight = _warpedDS->GetRasterYSize();
+    const bool cubic = _layer->interpolation() == Image::CUBIC || _layer->interpolation() == Image::CUBICSPLINE;
+    const int margin = cubic ? 1 : 0;
+
+    hf.fill(NO_DATA_VALUE);
+
+    // Pixel coordinates of each column and row of posts, relative to pixel centers,
+    // with posts within a half pixel of the edge pulled in as in getInterpolatedValue.
+    // NaN marks a post outside the dataset.
+    const double outside = std::numeric_limits<double>::quiet_NaN();
+    auto toPixelCenter = [&](double p, int limit)
+        {
+            p -= 0.5;
+            if (p < 0.0 && p >= -0.5) p = 0.0;
+            else if (p > limit - 1 && p <= limit - 0.5) p = limit - 1;
+            return (p < 0.0 || p > limit - 1) ? outside : p;
+        };
+
+    double dx = (xmax - xmin) / (tileSize - 1);
+    double dy = (ymax - ymin) / (tileSize - 1);
+
+    std::vector<double> cols(tileSize), rows(tileSize);
+    double colMin = DBL_MAX, colMax = -DBL_MAX, rowMin = DBL_MAX, rowMax = -DBL_MAX;
+    for (int i = 0; i < tileSize; ++i)
+    {
+        double c, r;
+        geoToPixel(xmin + dx * (double)i, ymin + dy * (double)i, c, r);
+        cols[i] = toPixelCenter(c, rasterWidth);
+        rows[i] = toPixelCenter(r, rasterHeight);
+        if (!std::isnan(cols[i])) colMin = std::min(colMin, cols[i]), colMax = std::max(colMax, cols[i]);
+        if (!std::isnan(rows[i])) rowMin = std::min(rowMin, rows[i]), rowMax = std::max(rowMax, rows[i]);
+    }
+
+    // no posts fall on the data
+    if (colMin > colMax || rowMin > rowMax)
+    {
+        return StatusOK;
+    }
+
+    // source window, with room for the interpolation kernel
+    int x0 = std::max((int)floor(colMin) - margin, 0);
+    int x1 = std::min((int)ceil(colMax) + margin, rasterWidth - 1);
+    int y0 = std::max((int)floor(rowMin) - margin, 0);
+    int y1 = std::min((int)ceil(rowMax) + margin, rasterHeight - 1);
+    int windowWidth = x1 - x0 + 1;
+    int windowHeight = y1 - y0 + 1;
+
+    // When the window is much larger than the tile (low LODs), let GDAL reduce it
+    // on read (from overviews if it has them) to twice the post spacing.
+    int bufferWidth = std::min(windowWidth, 2 * tileSize);
+    int bufferHeight = std::min(windowHeight, 2 * tileSize);
+    double scaleX = (double)windowWidth / (double)bufferWidth;
+    double scaleY = (double)windowHeight / (double)bufferHeight;
+
+    std::vector<float> buffer(bufferWidth * bufferHeight);
+    if (!readWindow(band, x0, y0, windowWidth, windowHeight, buffer.data(), bufferWidth, bufferHeight, GDT_Float32, _layer->interpolation()))
+    {
+        return Status(Status::GeneralError, "RasterIO failed");
+    }
+
+    // invalid values become NaN, which spreads to any post that touches one
+    int success = 0;
+    float noDataValueFromBand = (float)band->GetNoDataValue(&success);
+    if (!success) noDataValueFromBand = -32767.0f;
+
+    for (auto& v : buffer)
+    {
+        v = getValidElevationValue(v, noDataValueFromBand, std::numeric_limits<float>::quiet_NaN());
+    }
+
+    // Kernel taps for each column or row of posts: buffer indices and weights.
+    // Bilinear uses the first two; Catmull-Rom cubic uses all four.
+    struct Taps
+    {
+        int index[4] = { 0, 0, 0, 0 };
+        float weight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        bool valid = false;
+    };
+
+    auto makeTaps = [&](double p, int origin, double scale, int size)
+        {
+            Taps taps;
+            if (std::isnan(p))
+                return taps;
+
+            double b = std::clamp((p + 0.5 - (double)origin) / scale - 0.5, 0.0, (double)(size - 1));
+            int i = (int)floor(b);
+            float f = (float)(b - (double)i);
+
+            if (cubic)
+            {
+                for (int k = 0; k < 4; ++k)
+                    taps.index[k] = std::clamp(i - 1 + k, 0, size - 1);
+
+                taps.weight[0] = ((-0.5f * f + 1.0f) * f - 0.5f) * f;
+                taps.weight[1] = (1.5f * f - 2.5f) * f * f + 1.0f;
+                taps.weight[2] = ((-1.5f * f + 2.0f) * f + 0.5f) * f;
+                taps.weight[3] = (0.5f * f - 0.5f) * f * f;
+            }
+            else
+            {
+                // an exact hit only touches one pixel
+                taps.index[0] = i;
+                taps.index[1] = f > 0.0f ? std::min(i + 1, size - 1) : i;
+                taps.weight[0] = 1.0f - f;
+                taps.weight[1] = f;
+            }
+
+            taps.valid = true;
+            return taps;
+        };
+
+    const int numTaps = cubic ? 4 : 2;
+
+    std::vector<Taps> colTaps(tileSize), rowTaps(tileSize);
+    std::vector<bool> rowNeeded(bufferHeight, false);
+    for (int i = 0; i < tileSize; ++i)
+    {
+        colTaps[i] = makeTaps(cols[i], x0, scaleX, bufferWidth);
+        rowTaps[i] = makeTaps(rows[i], y0, scaleY, bufferHeight);
+        if (rowTaps[i].valid)
+        {
+            for (int k = 0; k < numTaps; ++k)
+                rowNeeded[rowTaps[i].index[k]] = true;
+        }
+    }
+
+    // pass 1: interpolate across each buffer row we need, at the post columns
+    std::vector<float> across(bufferHeight * tileSize, std::numeric_limits<float>::quiet_NaN());
+    for (int y = 0; y < bufferHeight; ++y)
+    {
+        if (!rowNeeded[y])
+            continue;
+
+        const float* line = &buffer[y * bufferWidth];
+        float* out = &across[y * tileSize];
+        for (int c = 0; c < tileSize; ++c)
+        {
+            const Taps& t = colTaps[c];
+            if (t.valid)
+            {
+                float sum = 0.0f;
+                for (int k = 0; k < numTaps; ++k)
+                    sum += t.weight[k] * line[t.index[k]];
+                out[c] = sum;
+            }
+        }
+    }
+
+    // pass 2: interpolate down the columns, a whole row of posts at a time
+    std::vector<float> posts(tileSize);
+    for (int r = 0; r < tileSize; ++r)
+    {
+        const Taps& t = rowTaps[r];
+        if (!t.valid)
+            continue;
+
+        std::fill(posts.begin(), posts.end(), 0.0f);
+        for (int k = 0; k < numTaps; ++k)
+        {
+            const float* in = &across[t.index[k] * tileSize];
+            const float w = t.weight[k];
+            for (int c = 0; c < tileSize; ++c)
+                posts[c] += w * in[c];
+        }
+
+        for (int c = 0; c < tileSize; ++c)
+        {
+            hf.heightAt(c, r) = std::isnan(posts[c]) ? NO_DATA_VALUE : posts[c] * (float)_linearUnits;
+        }
+    }
+
+    return StatusOK;
+}
+
+// Reads a window of a band into a buffer, like rasterIO. If the dataset has no
+// overviews of its own (GDAL picks from those itself), large reductions read from
+// overviews built in memory instead, since reading a low-LOD tile from the full
+// resolution raster would touch every pixel under it.
+bool
+GDAL::Driver::readWindow(GDALRasterBand* band, int x, int y, int width, int height, void* data, int bufWidth, int bufHeight, int gdalDataType, Image::Interpolation interpolation)
+{
+    auto type = (GDALDataType)gdalDataType;
+    double factor = std::min((double)width / (double)bufWidth, (double)height / (double)bufHeight);
+
+    if (factor >= MIN_OVERVIEW_FACTOR && band->GetOverviewCount() == 0 && _layer->buildOverviews() == true)
+    {
+        auto overviews = getOverviews();
+        if (overviews)
+        {
+            double window[4];
+            int i = selectLevel(overviews->levels, band->GetXSize(), band->GetYSize(), factor, x, y, width, height, window);
+            if (i >= 0)
+            {
+                // levels hold the raw values, so scale them as the source band would
+                std::scoped_lock lock(overviews->mutex);
+                auto levelBand = overviews->levels[i]->GetRasterBand(band->GetBand());
+                return rasterIO(levelBand, GF_Read, x, y, width, height, data, bufWidth, bufHeight, type, 0, 0, interpolation, window, band);
+            }
+        }
+    }
+
+    return rasterIO(band, GF_Read, x, y, width, height, data, bufWidth, bufHeight, type, 0, 0, interpolation);
+}
+
+// The in-memory overviews for this driver's dataset, building them on first
+// use; nullptr if the dataset is too small to need them or they can't be built.
+shared_ptr<GDAL::Overviews>
+GDAL::Driver::getOverviews()
+{
+    if (!_overviewsChecked)
+    {
+        _overviewsChecked = true;
+
+        // not worth it unless a low-LOD tile would cover many times its own size
+        int rasterWidth = _warpedDS->GetRasterXSize();
+        int rasterHeight = _warpedDS->GetRasterYSize();
+        if ((unsigned)std::max(rasterWidth, rasterHeight) <= 4u * _tileSize)
+            return nullptr;
+
+        {
+            std::scoped_lock lock(s_overviewsMutex);
+
+            for (auto i = s_overviews.begin(); i != s_overviews.end(); )
+            {
+                if (i->second.expired())
+                    i = s_overviews.erase(i);
+                else
+                    ++i;
+            }
+
+            auto& entry = s_overviews[_overviewsKey];
+            _overviews = entry.lock();
+            if (!_overviews)
+            {
+                _overviews = std::make_shared<Overviews>();
+                entry = _overviews;
+            }
+        }
+
+        // the first driver to get here builds them; any others wait
+        std::scoped_lock lock(_overviews->mutex);
+        if (!_overviews->built)
+        {
+            _overviews->built = true;
+            buildOverviews(*_overviews);
+        }
+    }
+
+    return _overviews && !_overviews->levels.empty() ? _overviews : nullptr;
+}
+
+// Builds the in-memory overviews by reducing the whole dataset once to fit
+// MAX_OVERVIEW_PIXELS, then halving each level from the one before until a
+// level fits in a tile. Levels keep each band's type and raw (unscaled) values.
+void
+GDAL::Driver::buildOverviews(Overviews& overviews)
+{
+#if GDAL_VERSION_2_0_OR_NEWER
+    auto mem = (GDALDriver*)GDALGetDriverByName("MEM");
+    int bands = _warpedDS->GetRasterCount();
+    if (!mem || bands == 0)
+        return;
+
+    int rasterWidth = _warpedDS->GetRasterXSize();
+    int rasterHeight = _warpedDS->GetRasterYSize();
+
+    int factor = 2;
+    while (((double)rasterWidth / factor) * ((double)rasterHeight / factor) > MAX_OVERVIEW_PIXELS)
+        factor *= 2;
+
+    auto start = std::chrono::steady_clock::now();
+    GDALDataset* source = _warpedDS;
+
+    for (;; factor *= 2)
+    {
+        int width = std::max((rasterWidth + factor - 1) / factor, 1);
+        int height = std::max((rasterHeight + factor - 1) / factor, 1);
+
+        GDALDataset* level = mem->Create("", width, height, 0, GDT_Byte, nullptr);
+        if (!level)
+            break;
+
+        std::vector<unsigned char> buffer;
+        bool ok = true;
+
+        for (int b = 1; b <= bands && ok; ++b)
+        {
+            GDALRasterBand* in = source->GetRasterBand(b);
+            GDALDataType type = in->GetRasterDataType();
+
+            ok = level->AddBand(type, nullptr) == CE_None;
+            if (!ok)
+                break;
+
+            GDALRasterBand* out = level->GetRasterBand(b);
+
+            int hasNoData = 0;
+            double noData = in->GetNoDataValue(&hasNoData);
+            if (hasNoData)
+                out->SetNoDataValue(noData);
+            out->SetColorInterpretation(in->GetColorInterpretation());
+            if (in->GetColorTable())
+                out->SetColorTable(in->GetColorTable());
+
+            // resample as tile reads do; blending palette indices would make up colors
+            GDALRasterIOExtraArg extra;
+            INIT_RASTERIO_EXTRA_ARG(extra);
+            extra.eResampleAlg = in->GetColorInterpretation() == GCI_PaletteIndex ?
+                GRIORA_NearestNeighbour :
+                resampleAlgorithm(_layer->interpolation());
+
+            buffer.resize((size_t)width * (size_t)height * (size_t)(GDALGetDataTypeSize(type) / 8));
+
+            ok =
+                in->RasterIO(GF_Read, 0, 0, in->GetXSize(), in->GetYSize(), buffer.data(), width, height, type, 0, 0, &extra) == CE_None &&
+                out->RasterIO(GF_Write, 0, 0, width, height, buffer.data(), width, height, type, 0, 0, nullptr) == CE_None;
+        }
+
+        if (!ok)
+        {
+            GDALClose(level);
+            break;
+        }
+
+        overviews.levels.push_back(level);
+        source = level;
+
+        if ((unsigned)std::max(width, height) <= _tileSize)
+            break;
+    }
+
+    if (!overviews.levels.empty())
+    {
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ROCKY_DEBUG << LC << "Built " << overviews.levels.size() << " in-memory overviews in " << ms << " ms" << std::endl;
+    }
+#endif
+}
+
+#if 0
 Result<shared_ptr<Heightfield>>
 GDAL::Driver::createHeightfieldWithVRT(
     const TileKey& key,
@@ -1792,6 +2302,170 @@ void GDAL::LayerBase::setCoverageUsesPaletteIndex(bool value) {
 const optional<bool>& GDAL::LayerBase::coverageUsesPaletteIndex() const {
     return _coverageUsesPaletteIndex;
 }
+void GDAL::LayerBase::setMaxDatasets(unsigned value) {
+    _maxDatasets = value;
+}
+const optional<unsigned>& GDAL::LayerBase::maxDatasets() const {
+    return _maxDatasets;
+}
+
+void GDAL::LayerBase::setBuildOverviews(bool value) {
+    _buildOverviews = value;
+}
+const optional<bool>& GDAL::LayerBase::buildOverviews() const {
+    return _buildOverviews;
+}
+
+//......................................................................
+
+GDAL::DriverPool::Lease&
+GDAL::DriverPool::Lease::operator = (Lease&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        release();
+        _pool = rhs._pool;
+        _driver = std::move(rhs._driver);
+        _generation = rhs._generation;
+        rhs._pool = nullptr;
+    }
+    return *this;
+}
+
+void
+GDAL::DriverPool::Lease::release()
+{
+    if (_pool)
+    {
+        _pool->put(std::move(_driver), _generation);
+        _pool = nullptr;
+    }
+}
+
+void
+GDAL::DriverPool::setMaxSize(unsigned value)
+{
+    std::scoped_lock lock(_mutex);
+    _maxSize = value;
+}
+
+unsigned
+GDAL::DriverPool::maxSize() const
+{
+    std::scoped_lock lock(_mutex);
+    return _maxSize > 0u ? _maxSize : util::getConcurrency();
+}
+
+GDAL::DriverPool::Lease
+GDAL::DriverPool::acquire(const Factory& factory, const Cancelable* cancelable)
+{
+    Lease lease;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    const unsigned max_open = _maxSize > 0u ? _maxSize : util::getConcurrency();
+
+    std::chrono::steady_clock::time_point waitStart;
+    bool waited = false;
+
+    for (;;)
+    {
+        if (!_idle.empty())
+        {
+            // the most recently used driver has the warmest block cache
+            lease._driver = std::move(_idle.back());
+            _idle.pop_back();
+            break;
+        }
+
+        if (_stats.open < max_open)
+        {
+            // reserve the slot, then open the dataset without holding the lock
+            ++_stats.open;
+            lock.unlock();
+            lease._driver = factory ? factory() : nullptr;
+            lock.lock();
+
+            if (!lease._driver)
+            {
+                --_stats.open;
+                _released.notify_one();
+                return lease;
+            }
+
+            ++_stats.created;
+            _stats.peak = std::max(_stats.peak, _stats.open);
+            break;
+        }
+
+        if (cancelable && cancelable->canceled())
+            return lease;
+
+        if (!waited)
+        {
+            waited = true;
+            waitStart = std::chrono::steady_clock::now();
+        }
+
+        // poll so we notice cancelation
+        _released.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    ++_stats.checkouts;
+    if (waited)
+    {
+        ++_stats.waits;
+        _stats.waitTime += std::chrono::steady_clock::now() - waitStart;
+    }
+
+    lease._pool = this;
+    lease._generation = _generation;
+    return lease;
+}
+
+void
+GDAL::DriverPool::put(shared_ptr<Driver> driver, unsigned generation)
+{
+    shared_ptr<Driver> discarded;
+    {
+        std::scoped_lock lock(_mutex);
+        const unsigned max_open = _maxSize > 0u ? _maxSize : util::getConcurrency();
+
+        // keep it unless the pool was cleared or shrunk while it was out
+        if (driver && generation == _generation && _stats.open <= max_open)
+        {
+            _idle.emplace_back(std::move(driver));
+        }
+        else
+        {
+            discarded = std::move(driver);
+            if (_stats.open > 0u)
+                --_stats.open;
+        }
+    }
+    _released.notify_one();
+
+    // discarded driver closes its dataset here, outside the lock
+}
+
+GDAL::DriverPool::Stats
+GDAL::DriverPool::stats() const
+{
+    std::scoped_lock lock(_mutex);
+    return _stats;
+}
+
+void
+GDAL::DriverPool::clear()
+{
+    std::vector<shared_ptr<Driver>> discarded;
+    {
+        std::scoped_lock lock(_mutex);
+        discarded.swap(_idle);
+        _stats.open -= std::min(_stats.open, (unsigned)discarded.size());
+        ++_generation;
+    }
+    _released.notify_all();
+}
 
 //......................................................................
 
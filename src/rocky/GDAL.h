@@ -11,6 +11,9 @@
 #include <rocky/Image.h>
 #include <rocky/GeoExtent.h>
 #include <rocky/TileKey.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 
 class GDALDataset;
 class GDALRasterBand;
@@ -58,6 +61,17 @@ namespace ROCKY_NAMESPACE
             void setCoverageUsesPaletteIndex(bool value);
             const optional<bool>& coverageUsesPaletteIndex() const;
 
+            //! Most datasets to keep open at once, each usable by one thread at
+            //! a time. More than this many simultaneous reads wait their turn.
+            //! Default (0) is the number of CPU cores.
+            void setMaxDatasets(unsigned value);
+            const optional<unsigned>& maxDatasets() const;
+
+            //! Whether to build reduced copies of the dataset in memory for
+            //! low-LOD reads when it has no overviews of its own (default is true)
+            void setBuildOverviews(bool value);
+            const optional<bool>& buildOverviews() const;
+
         protected:
             optional<URI> _uri = { };
             optional<std::string> _connection = { };
@@ -66,8 +80,13 @@ namespace ROCKY_NAMESPACE
             optional<bool> _useVRT = false;
             optional<bool> _coverageUsesPaletteIndex = true;
             optional<bool> _singleThreaded = false;
+            optional<unsigned> _maxDatasets = 0u;
+            optional<bool> _buildOverviews = true;
         };
 
+        //! In-memory overviews of a dataset, shared by the drivers that read it
+        struct Overviews;
+
         /**
          * Driver for reading raster data using GDAL.
          * It is rarely necessary to use this object directly; use a
@@ -108,13 +127,20 @@ namespace ROCKY_NAMESPACE
                 bool isCoverage,
                 const IOOptions& io);
 
-#if 0
-            //! Creates a heightfield if possible
+            //! Creates a heightfield if possible, sampling the dataset at each
+            //! post of the tile. Fails with ConfigurationError if the dataset
+            //! doesn't look like elevation data (e.g., RGB-encoded heights).
             Result<shared_ptr<Heightfield>> createHeightfield(
                 const TileKey& key,
                 unsigned tileSize,
                 const IOOptions& io);
 
+            //! Height at one point (in the dataset's SRS), interpolated the way
+            //! createHeightfield would but reading the dataset point by point.
+            //! Slow; meant for spot checks. Returns NO_DATA_VALUE if there's no data.
+            float heightAt(double x, double y);
+
+#if 0
             //! Creates a heightfield if possible using a faster path that creates a temporary warped VRT.
             Result<shared_ptr<Heightfield>> createHeightfieldWithVRT(
                 const TileKey& key,
@@ -134,6 +160,10 @@ namespace ROCKY_NAMESPACE
             float getValidElevationValue(float value, float nodataValueFromBand, float replacement);
             bool intersects(const TileKey&);
             float getInterpolatedValue(GDALRasterBand* band, double x, double y, bool applyOffset = true);
+            Status sampleHeightfield(GDALRasterBand* band, double xmin, double ymin, double xmax, double ymax, Heightfield& hf);
+            bool readWindow(GDALRasterBand* band, int x, int y, int width, int height, void* data, int bufWidth, int bufHeight, int gdalDataType, Image::Interpolation interpolation);
+            shared_ptr<Overviews> getOverviews();
+            void buildOverviews(Overviews&);
 
             optional<float> _noDataValue, _minValidValue, _maxValidValue;
             optional<unsigned> _maxDataLevel;
@@ -149,10 +179,91 @@ namespace ROCKY_NAMESPACE
             shared_ptr<ExternalDataset> _external;
             std::string _name;
             std::thread::id _threadId;
+            unsigned _tileSize = 256u;
+            std::string _overviewsKey;
+            shared_ptr<Overviews> _overviews;
+            bool _overviewsChecked = false;
 
             const std::string& getName() const { return _name; }
         };
 
+        /**
+         * Bounded pool of open drivers for one layer.
+         *
+         * A GDAL dataset is only safe to use from one thread at a time, so each
+         * read checks a driver out of the pool and the Lease returns it after.
+         * The pool opens another driver only when every open one is busy, up to
+         * a limit, so open datasets (and their block caches) grow with the number
+         * of overlapping reads rather than with the number of threads.
+         */
+        class ROCKY_EXPORT DriverPool
+        {
+        public:
+            //! Function that makes and opens a new driver, or returns nullptr
+            using Factory = std::function<shared_ptr<Driver>()>;
+
+            //! A driver checked out of the pool
+            class ROCKY_EXPORT Lease
+            {
+            public:
+                Lease() = default;
+                Lease(Lease&& rhs) noexcept { *this = std::move(rhs); }
+                Lease& operator = (Lease&& rhs) noexcept;
+                ~Lease() { release(); }
+
+                //! Whether the lease holds a driver
+                explicit operator bool() const { return _driver != nullptr; }
+
+                //! The driver
+                Driver* operator -> () const { return _driver.get(); }
+
+                //! Return the driver to the pool now
+                void release();
+
+            private:
+                DriverPool* _pool = nullptr;
+                shared_ptr<Driver> _driver;
+                unsigned _generation = 0u;
+                friend class DriverPool;
+            };
+
+            //! Usage counters
+            struct Stats
+            {
+                unsigned open = 0u;         // drivers open now (idle or checked out)
+                unsigned peak = 0u;         // most drivers ever open at once
+                unsigned created = 0u;      // drivers opened
+                std::uint64_t checkouts = 0u;   // leases handed out
+                std::uint64_t waits = 0u;       // checkouts that waited for a driver
+                std::chrono::steady_clock::duration waitTime = { }; // total time spent waiting
+            };
+
+            //! Most drivers open at once; 0 means the number of CPU cores
+            void setMaxSize(unsigned value);
+            unsigned maxSize() const;
+
+            //! Check out a driver, opening one with the factory if all are busy
+            //! and the pool isn't full; otherwise wait for one to come back.
+            //! Returns an empty lease if the factory fails or the wait is canceled.
+            Lease acquire(const Factory& factory, const Cancelable* cancelable = nullptr);
+
+            //! Usage counters
+            Stats stats() const;
+
+            //! Close the idle drivers; drivers checked out now close when returned
+            void clear();
+
+        private:
+            mutable std::mutex _mutex;
+            std::condition_variable _released;
+            std::vector<shared_ptr<Driver>> _idle;
+            unsigned _maxSize = 0u;
+            unsigned _generation = 0u;
+            Stats _stats;
+
+            void put(shared_ptr<Driver> driver, unsigned generation);
+        };
+
         //! Reads an image from raw data using the specified GDAL driver.
         extern ROCKY_EXPORT Result<shared_ptr<Image>> readImage(
             unsigned char* data, unsigned len, const std::string& gdal_driver);
@@ -12,7 +12,7 @@ using namespace ROCKY_NAMESPACE::GDAL;
 namespace
 {
     template<typename T>
-    Status openOnThisThread(
+    Status openDriver(
         const T* layer,
         shared_ptr<GDAL::Driver>& driver,
         Profile* profile,
@@ -76,6 +76,8 @@ GDALElevationLayer::construct(const JSON& conf)
     if (temp == "nearest") _interpolation = Image::NEAREST;
     else if (temp == "bilinear") _interpolation = Image::BILINEAR;
     get_to(j, "single_threaded", _singleThreaded);
+    get_to(j, "max_datasets", _maxDatasets);
+    get_to(j, "build_overviews", _buildOverviews);
 
     setRenderType(RENDERTYPE_TERRAIN_SURFACE);
 }
@@ -92,6 +94,8 @@ GDALElevationLayer::to_json() const
     else if (_interpolation.has_value(Image::BILINEAR))
         set(j, "interpolation", "bilinear");
     set(j, "single_threaded", _singleThreaded);
+    set(j, "max_datasets", _maxDatasets);
+    set(j, "build_overviews", _buildOverviews);
     return j.dump();
 }
 
@@ -104,20 +108,24 @@ GDALElevationLayer::openImplementation(const IOOptions& io)
 
     Profile profile;
 
-    // GDAL thread-safety requirement: each thread requires a separate GDALDataSet.
-    // So we just encapsulate the entire setup once per thread.
+    // GDAL thread-safety requirement: a GDALDataSet can only be used by one thread
+    // at a time. So each read checks a driver out of a pool, which opens more of
+    // them as concurrent reads need them.
     // https://trac.osgeo.org/gdal/wiki/FAQMiscellaneous#IstheGDALlibrarythread-safe
 
-    auto& driver = _drivers.value();
+    _drivers.clear();
+    _drivers.setMaxSize(_singleThreaded == true ? 1u : _maxDatasets.value());
 
     DataExtentList dataExtents;
 
-    Status s = openOnThisThread(
-        this,
-        driver,
-        &profile,
-        &dataExtents,
-        io);
+    // the first driver reads the profile and extents, then goes in the pool
+    Status s;
+    auto driver = _drivers.acquire([&]()
+        {
+            shared_ptr<GDAL::Driver> newDriver;
+            s = openDriver(this, newDriver, &profile, &dataExtents, io);
+            return s.ok() ? newDriver : nullptr;
+        });
 
     if (s.failed())
         return s;
@@ -136,7 +144,7 @@ GDALElevationLayer::openImplementation(const IOOptions& io)
 void
 GDALElevationLayer::closeImplementation()
 {
-    // safely shut down all per-thread handles.
+    // safely shut down all pooled handles.
     _drivers.clear();
 
     super::closeImplementation();
@@ -150,16 +158,28 @@ GDALElevationLayer::createHeightfieldImplementation(
     if (status().failed())
         return status();
 
-    auto& driver = _drivers.value();
-    if (driver == nullptr)
-    {
-        // calling openImpl with NULL params limits the setup
-        // since we already called this during openImplementation
-        openOnThisThread(this, driver, nullptr, nullptr, io);
-    }
+    auto driver = _drivers.acquire([&]()
+        {
+            // calling openDriver with NULL params limits the setup
+            // since we already called this during openImplementation
+            shared_ptr<GDAL::Driver> newDriver;
+            return openDriver(this, newDriver, nullptr, nullptr, io).ok() ? newDriver : nullptr;
+        }, &io);
 
     if (driver)
     {
+        // elevation values: sample them straight into the heightfield
+        auto heights = driver->createHeightfield(key, tileSize(), io);
+        if (heights.status.ok())
+        {
+            return GeoHeightfield(heights.value, key.extent());
+        }
+        else if (heights.status.code != Status::ConfigurationError)
+        {
+            return GeoHeightfield::INVALID;
+        }
+
+        // otherwise the heights may be encoded as RGB
         auto r = driver->createImage(key, tileSize(), false, io);
 
         if (r.status.ok())
@@ -14,7 +14,7 @@ using namespace ROCKY_NAMESPACE::GDAL;
 namespace
 {
     template<typename T>
-    Status openOnThisThread(
+    Status openDriver(
         const T* layer,
         shared_ptr<GDAL::Driver>& driver,
         Profile* profile,
@@ -71,6 +71,8 @@ GDALImageLayer::construct(const JSON& conf)
     if (temp == "nearest") _interpolation = Image::NEAREST;
     else if (temp == "bilinear") _interpolation = Image::BILINEAR;
     get_to(j, "single_threaded", _singleThreaded);
+    get_to(j, "max_datasets", _maxDatasets);
+    get_to(j, "build_overviews", _buildOverviews);
 
     setRenderType(RENDERTYPE_TERRAIN_SURFACE);
 }
@@ -87,6 +89,8 @@ GDALImageLayer::to_json() const
     else if (_interpolation.has_value(Image::BILINEAR))
         set(j, "interpolation", "bilinear");
     set(j, "single_threaded", _singleThreaded);
+    set(j, "max_datasets", _maxDatasets);
+    set(j, "build_overviews", _buildOverviews);
     return j.dump();
 }
 
@@ -99,20 +103,24 @@ GDALImageLayer::openImplementation(const IOOptions& io)
 
     Profile profile;
 
-    // GDAL thread-safety requirement: each thread requires a separate GDALDataSet.
-    // So we just encapsulate the entire setup once per thread.
+    // GDAL thread-safety requirement: a GDALDataSet can only be used by one thread
+    // at a time. So each read checks a driver out of a pool, which opens more of
+    // them as concurrent reads need them.
     // https://trac.osgeo.org/gdal/wiki/FAQMiscellaneous#IstheGDALlibrarythread-safe
 
-    auto& driver = _drivers.value();
+    _drivers.clear();
+    _drivers.setMaxSize(_singleThreaded == true ? 1u : _maxDatasets.value());
 
     DataExtentList dataExtents;
 
-    Status s = openOnThisThread(
-        this,
-        driver,
-        &profile,
-        &dataExtents,
-        io);
+    // the first driver reads the profile and extents, then goes in the pool
+    Status s;
+    auto driver = _drivers.acquire([&]()
+        {
+            shared_ptr<GDAL::Driver> newDriver;
+            s = openDriver(this, newDriver, &profile, &dataExtents, io);
+            return s.ok() ? newDriver : nullptr;
+        });
 
     if (s.failed())
         return s;
@@ -131,7 +139,7 @@ GDALImageLayer::openImplementation(const IOOptions& io)
 void
 GDALImageLayer::closeImplementation()
 {
-    // safely shut down all per-thread handles.
+    // safely shut down all pooled handles.
     _drivers.clear();
 
     super::closeImplementation();
@@ -145,13 +153,13 @@ GDALImageLayer::createImageImplementation(
     if (status().failed())
         return status();
 
-    auto& driver = _drivers.value();
-    if (driver == nullptr)
-    {
-        // calling openImpl with NULL params limits the setup
-        // since we already called this during openImplementation
-        openOnThisThread(this, driver, nullptr, nullptr, io);
-    }
+    auto driver = _drivers.acquire([&]()
+        {
+            // calling openDriver with NULL params limits the setup
+            // since we already called this during openImplementation
+            shared_ptr<GDAL::Driver> newDriver;
+            return openDriver(this, newDriver, nullptr, nullptr, io).ok() ? newDriver : nullptr;
+        }, &io);
 
     if (driver)
     {
@@ -26,6 +26,9 @@ namespace ROCKY_NAMESPACE
         //! Serialize the layer
         JSON to_json() const override;
 
+        //! Usage of the pool of open datasets (see maxDatasets)
+        GDAL::DriverPool::Stats datasetStats() const { return _drivers.stats(); }
+
     protected: // Layer
 
         //! Establishes a connection to the GDAL data source
@@ -44,7 +47,7 @@ namespace ROCKY_NAMESPACE
         //! Called by the constructors
         void construct(const JSON&);
 
-        mutable util::ThreadLocal<shared_ptr<GDAL::Driver>> _drivers;
+        mutable GDAL::DriverPool _drivers;
         friend class GDAL::Driver;
     };
 
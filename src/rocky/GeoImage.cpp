@@ -2,6 +2,7 @@
 #include "Math.h"
 #include "Image.h"
 #include "Metrics.h"
+#include "Threading.h"
 
 #ifdef GDAL_FOUND
 #include <gdal.h>
@@ -364,13 +365,6 @@ namespace
             dest_extent.xMax() - .5 * dx, dest_extent.yMax() - .5 * dy,
             srcPointsX, srcPointsY, width, height);
 
-        //ImageUtils::PixelReader ia(image);
-        Image::Pixel color;
-        Image::Pixel urColor;
-        Image::Pixel llColor;
-        Image::Pixel ulColor;
-        Image::Pixel lrColor;
-
         double xfac = (image->width() - 1) / src_extent.width();
         double yfac = (image->height() - 1) / src_extent.height();
 
@@ -378,11 +372,17 @@ namespace
         {
             // Next, go through the source-SRS sample grid, read the color at each point from the source image,
             // and write it to the corresponding pixel in the destination image.
-            int pixel = 0;
-            double xfac = (image->width() - 1) / src_extent.width();
-            double yfac = (image->height() - 1) / src_extent.height();
-            for (unsigned int c = 0; c < width; ++c)
+            // Each column writes its own pixels, so columns can run in parallel.
+            util::parallel_for(0u, width, [&](unsigned int c)
             {
+                //ImageUtils::PixelReader ia(image);
+                Image::Pixel color;
+                Image::Pixel urColor;
+                Image::Pixel llColor;
+                Image::Pixel ulColor;
+                Image::Pixel lrColor;
+
+                int pixel = c * height;
                 for (unsigned int r = 0; r < height; ++r)
                 {
                     double src_x = srcPointsX[pixel];
@@ -471,7 +471,7 @@ namespace
                     result->write(color, c, r, depth);
                     pixel++;
                 }
-            }
+            });
         }
 
         delete[] srcPointsX;
@@ -742,10 +742,10 @@ GeoImage::reproject(
 void
 GeoImage::composite(const std::vector<GeoImage>& sources)
 {
-    double x, y;
-    glm::fvec4 pixel;
-    for (unsigned t = 0; t < _image->width(); ++t)
+    util::parallel_for(0u, _image->width(), [&](unsigned t)
     {
+        double x, y;
+        glm::fvec4 pixel;
         for(unsigned s = 0; s < _image->height(); ++s)
         {
             // read the existing pixel
@@ -771,7 +771,7 @@ GeoImage::composite(const std::vector<GeoImage>& sources)
                 }
             }
         }
-    }
+    });
 }
 
 bool
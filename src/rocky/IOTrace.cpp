@@ -0,0 +1,240 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#include "IOTrace.h"
+#include "Threading.h"
+#include "json.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <thread>
+
+using namespace ROCKY_NAMESPACE;
+
+namespace
+{
+    // record of the innermost scope on this thread
+    thread_local IOTracer::Record* t_current = nullptr;
+
+    inline double to_ms(IOTracer::Clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    void accumulate(IOTracer::Summary& summary, const IOTracer::Record& record)
+    {
+        summary.count++;
+        summary.requests += record.requests;
+        summary.connects += record.connects;
+        summary.cacheHits += record.cacheHits;
+        summary.cacheMisses += record.cacheMisses;
+        summary.bytes += record.bytes;
+        for (unsigned i = 0; i < IOTracer::NUM_PHASES; ++i)
+            summary.time[i].add(to_ms(record.time[i]));
+    }
+}
+
+const std::array<double, IOTracer::Histogram::NUM_BUCKETS - 1> IOTracer::Histogram::bounds = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000
+};
+
+void
+IOTracer::Histogram::add(double ms)
+{
+    unsigned b = 0;
+    while (b < bounds.size() && ms > bounds[b])
+        ++b;
+    counts[b]++;
+    count++;
+    sum += ms;
+    max = std::max(max, ms);
+}
+
+double
+IOTracer::Histogram::percentile(double p) const
+{
+    if (count == 0)
+        return 0.0;
+
+    auto rank = (std::uint64_t)std::ceil(std::clamp(p, 0.0, 1.0) * (double)count);
+    std::uint64_t seen = 0;
+    for (unsigned b = 0; b < NUM_BUCKETS; ++b)
+    {
+        seen += counts[b];
+        if (seen >= rank && counts[b] > 0)
+            return b < bounds.size() ? std::min(bounds[b], max) : max;
+    }
+    return max;
+}
+
+const char*
+IOTracer::phaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case QUEUE: return "queue";
+    case WAIT: return "wait";
+    case CONNECT: return "connect";
+    case FIRST_BYTE: return "first_byte";
+    case TRANSFER: return "transfer";
+    case DECODE: return "decode";
+    case TOTAL: return "total";
+    default: return "";
+    }
+}
+
+IOTracer::Scope::Scope(const IOOptions& io, const std::string& layer, const std::string& name) :
+    _tracer(io.services().tracer)
+{
+    if (_tracer)
+    {
+        _record.layer = layer;
+        _record.name = name;
+        _record.start = Clock::now();
+        // a job's queue wait belongs to its first scope only; nested or
+        // later scopes in the same job didn't wait again
+        _record.time[QUEUE] = util::job::takeQueueWait();
+        _record.thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+        _outer = t_current;
+        t_current = &_record;
+    }
+}
+
+IOTracer::Scope::~Scope()
+{
+    if (_tracer)
+    {
+        t_current = _outer;
+        _record.time[TOTAL] = Clock::now() - _record.start;
+        _tracer->add(_record);
+    }
+}
+
+IOTracer::IOTracer(std::size_t maxRecords) :
+    _maxRecords(maxRecords),
+    _epoch(Clock::now())
+{
+    //nop
+}
+
+IOTracer::Record*
+IOTracer::current()
+{
+    return t_current;
+}
+
+void
+IOTracer::add(const Record& record)
+{
+    std::scoped_lock lock(_mutex);
+
+    if (_maxRecords > 0)
+    {
+        if (_records.size() >= _maxRecords)
+            _records.pop_front();
+        _records.push_back(record);
+    }
+
+    accumulate(_byLayer[record.layer], record);
+    if (!record.host.empty())
+        accumulate(_byHost[record.host], record);
+}
+
+std::vector<IOTracer::Record>
+IOTracer::records() const
+{
+    std::scoped_lock lock(_mutex);
+    return std::vector<Record>(_records.begin(), _records.end());
+}
+
+std::map<std::string, IOTracer::Summary>
+IOTracer::byLayer() const
+{
+    std::scoped_lock lock(_mutex);
+    return _byLayer;
+}
+
+std::map<std::string, IOTracer::Summary>
+IOTracer::byHost() const
+{
+    std::scoped_lock lock(_mutex);
+    return _byHost;
+}
+
+void
+IOTracer::clear()
+{
+    std::scoped_lock lock(_mutex);
+    _records.clear();
+    _byLayer.clear();
+    _byHost.clear();
+}
+
+std::string
+IOTracer::toCSV() const
+{
+    auto quoted = [](const std::string& value)
+        {
+            std::string out = "\"";
+            for (auto c : value)
+                out += (c == '"') ? std::string("\"\"") : std::string(1, c);
+            return out + "\"";
+        };
+
+    std::ostringstream out;
+    out << "layer,name,host,start_ms";
+    for (unsigned i = 0; i < NUM_PHASES; ++i)
+        out << ',' << phaseName((Phase)i) << "_ms";
+    out << ",requests,connects,cache_hits,cache_misses,bytes\n";
+
+    for (auto& r : records())
+    {
+        out << quoted(r.layer) << ',' << quoted(r.name) << ',' << quoted(r.host) << ',' << to_ms(r.start - _epoch);
+        for (unsigned i = 0; i < NUM_PHASES; ++i)
+            out << ',' << to_ms(r.time[i]);
+        out << ',' << r.requests << ',' << r.connects << ',' << r.cacheHits << ',' << r.cacheMisses << ',' << r.bytes << '\n';
+    }
+
+    return out.str();
+}
+
+std::string
+IOTracer::toChromeTrace() const
+{
+    auto to_us = [](Clock::duration d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+
+    auto events = json::array();
+    for (auto& r : records())
+    {
+        auto tid = r.thread % 100000u;
+
+        // time spent in the job queue, just ahead of the operation itself
+        if (r.time[QUEUE].count() > 0)
+        {
+            events.push_back({
+                { "name", "queue" }, { "cat", r.layer }, { "ph", "X" },
+                { "ts", to_us(r.start - _epoch - r.time[QUEUE]) }, { "dur", to_us(r.time[QUEUE]) },
+                { "pid", 1 }, { "tid", tid } });
+        }
+
+        auto args = json::object();
+        for (unsigned i = 0; i < NUM_PHASES; ++i)
+            args[std::string(phaseName((Phase)i)) + "_ms"] = to_ms(r.time[i]);
+        args["host"] = r.host;
+        args["requests"] = r.requests;
+        args["cache_hits"] = r.cacheHits;
+        args["cache_misses"] = r.cacheMisses;
+        args["bytes"] = r.bytes;
+
+        events.push_back({
+            { "name", r.layer + " " + r.name }, { "cat", r.layer }, { "ph", "X" },
+            { "ts", to_us(r.start - _epoch) }, { "dur", to_us(r.time[TOTAL]) },
+            { "pid", 1 }, { "tid", tid }, { "args", args } });
+    }
+
+    json j = { { "traceEvents", events }, { "displayTimeUnit", "ms" } };
+    return j.dump();
+}
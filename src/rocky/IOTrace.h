@@ -0,0 +1,156 @@
+/**
+ * rocky c++
+ * Copyright 2023 Pelican Mapping
+ * MIT License
+ */
+#pragma once
+
+#include <rocky/IOTypes.h>
+#include <array>
+#include <deque>
+#include <map>
+
+namespace ROCKY_NAMESPACE
+{
+    /**
+     * Collects timing records for IO operations (usually one per tile request)
+     * so you can see whether slow tiles are bound by scheduling, the network,
+     * or decoding.
+     *
+     * Tracing is off unless a tracer is installed in the IO services:
+     *   auto tracer = IOTracer::create();
+     *   instance.ioOptions().services().tracer = tracer;
+     *   ...
+     *   std::cout << tracer->toCSV();
+     *
+     * Layers open a Scope around each tile request; the IO code below it adds
+     * to the scope's record through IOTracer::current(). Records are kept for
+     * the most recent requests, and summarized per layer and per host into
+     * latency histograms.
+     */
+    class ROCKY_EXPORT IOTracer : public Inherit<Object, IOTracer>
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        //! Parts of an operation that are timed
+        enum Phase
+        {
+            QUEUE,      // waiting in a job queue before starting
+            WAIT,       // waiting for a rate limit or a free connection
+            CONNECT,    // setting up a new connection and resolving its host
+            FIRST_BYTE, // sending a request until the first byte of the reply (includes the TCP/TLS handshakes)
+            TRANSFER,   // receiving the rest of the reply
+            DECODE,     // decompressing and decoding content
+            TOTAL,      // start to finish, not counting QUEUE
+            NUM_PHASES
+        };
+
+        //! Name of a phase, e.g. "first_byte"
+        static const char* phaseName(Phase phase);
+
+        //! Timing record of one operation
+        struct Record
+        {
+            std::string layer;      // layer that made the request
+            std::string name;       // what was requested, e.g. a tile key
+            std::string host;       // last host contacted, if any
+            Clock::time_point start;
+            std::array<Clock::duration, NUM_PHASES> time = { };
+            unsigned requests = 0u;     // network requests made
+            unsigned connects = 0u;     // new network connections opened
+            unsigned cacheHits = 0u;    // reads satisfied by a cache
+            unsigned cacheMisses = 0u;  // cache lookups that failed
+            std::uint64_t bytes = 0u;   // bytes received over the network
+            std::size_t thread = 0u;    // thread that ran the operation
+        };
+
+        //! Latency histogram with exponential buckets (1ms, 2ms, 5ms, 10ms, ...)
+        struct Histogram
+        {
+            static constexpr unsigned NUM_BUCKETS = 14u;
+            static const std::array<double, NUM_BUCKETS - 1> bounds; // upper bounds in ms
+
+            std::array<std::uint64_t, NUM_BUCKETS> counts = { };
+            std::uint64_t count = 0u;
+            double sum = 0.0; // ms
+            double max = 0.0; // ms
+
+            void add(double ms);
+
+            double mean() const { return count > 0 ? sum / (double)count : 0.0; }
+
+            //! Approximate percentile in ms (upper bound of the bucket it falls in)
+            double percentile(double p) const;
+        };
+
+        //! Aggregate of many records
+        struct Summary
+        {
+            std::uint64_t count = 0u;
+            std::uint64_t requests = 0u;
+            std::uint64_t connects = 0u;
+            std::uint64_t cacheHits = 0u;
+            std::uint64_t cacheMisses = 0u;
+            std::uint64_t bytes = 0u;
+            std::array<Histogram, NUM_PHASES> time;
+        };
+
+        /**
+         * Traces the operations on the calling thread for its lifetime.
+         * Does nothing if the IO options have no tracer.
+         */
+        class ROCKY_EXPORT Scope
+        {
+        public:
+            Scope(const IOOptions& io, const std::string& layer, const std::string& name);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator = (const Scope&) = delete;
+
+        private:
+            shared_ptr<IOTracer> _tracer;
+            Record _record;
+            Record* _outer = nullptr;
+        };
+
+    public:
+        //! Construct a tracer
+        //! @param maxRecords Number of recent records to keep
+        IOTracer(std::size_t maxRecords = 10000u);
+
+        //! Record of the operation being traced on the calling thread, or nullptr
+        static Record* current();
+
+        //! Add a finished record
+        void add(const Record& record);
+
+        //! Most recent records, oldest first
+        std::vector<Record> records() const;
+
+        //! Summary of every record since construction or clear(), by layer name
+        std::map<std::string, Summary> byLayer() const;
+
+        //! Summary of every record since construction or clear(), by host
+        std::map<std::string, Summary> byHost() const;
+
+        //! Discard all records and summaries
+        void clear();
+
+        //! Recent records as CSV, one row per record, times in ms
+        std::string toCSV() const;
+
+        //! Recent records in Chrome's trace event format
+        //! (load in chrome://tracing or https://ui.perfetto.dev)
+        std::string toChromeTrace() const;
+
+    private:
+        mutable std::mutex _mutex;
+        std::size_t _maxRecords;
+        std::deque<Record> _records;
+        std::map<std::string, Summary> _byLayer;
+        std::map<std::string, Summary> _byHost;
+        Clock::time_point _epoch;
+    };
+}
@@ -4,8 +4,23 @@
  * MIT License
  */
 #include "IOTypes.h"
+#include "Image.h"
 #include "Instance.h"
+#include "Utils.h"
 #include "json.h"
+#include <cstring>
+
+#ifdef _WIN32
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#undef min
+#undef max
 
 using namespace ROCKY_NAMESPACE;
 
@@ -28,6 +43,26 @@ namespace ROCKY_NAMESPACE
         get_to(j, "username", obj.username);
         get_to(j, "password", obj.password);
     }
+
+    void to_json(json& j, const CachePolicy& obj) {
+        j = json::object();
+        if (obj.usage.has_value())
+            set(j, "usage", obj.usageString());
+        set(j, "max_age", obj.maxAge);
+    }
+
+    void from_json(const json& j, CachePolicy& obj) {
+        std::string usage;
+        if (get_to(j, "usage", usage))
+        {
+            usage = util::toLower(usage);
+            if (usage == "read-write") obj.usage = CachePolicy::Usage::READ_WRITE;
+            else if (usage == "read-only") obj.usage = CachePolicy::Usage::READ_ONLY;
+            else if (usage == "cache-only") obj.usage = CachePolicy::Usage::CACHE_ONLY;
+            else if (usage == "no-cache") obj.usage = CachePolicy::Usage::NO_CACHE;
+        }
+        get_to(j, "max_age", obj.maxAge);
+    }
 }
 
 
@@ -73,10 +108,18 @@ CachePolicy::mergeAndOverride(const optional<CachePolicy>& rhs)
 DateTime
 CachePolicy::getMinAcceptTime() const
 {
-    return
-        minTime.has_value() ? minTime.value() :
-        maxAge.has_value() ? DateTime().asTimeStamp() - maxAge.value() :
-        0;
+    if (minTime.has_value())
+        return minTime.value();
+
+    if (maxAge.has_value())
+    {
+        // maxAge may be in any time units, and defaults to "forever"
+        double seconds = maxAge.value().as(Units::SECONDS);
+        TimeStamp now = DateTime().asTimeStamp();
+        return seconds < (double)now ? DateTime(now - (TimeStamp)seconds) : DateTime((TimeStamp)0);
+    }
+
+    return DateTime((TimeStamp)0);
 }
 
 bool
@@ -131,12 +174,10 @@ IOOptions::IOOptions(Cancelable& c) :
     //nop
 }
 
-IOOptions::IOOptions(const IOOptions& rhs, Cancelable& c) :
-    _services(rhs._services),
-    _properties(rhs._properties),
-    _cancelable(&c)
+IOOptions::IOOptions(const IOOptions& rhs, Cancelable& c)
 {
-    //nop
+    this->operator=(rhs);
+    _cancelable = &c;
 }
 
 IOOptions&
@@ -145,21 +186,472 @@ IOOptions::operator = (const IOOptions& rhs)
     _cancelable = rhs._cancelable;
     _services = rhs._services;
     _properties = rhs._properties;
+    maxNetworkAttempts = rhs.maxNetworkAttempts;
+    maxRequestsPerHost = rhs.maxRequestsPerHost;
+    maxRequestsPerSecond = rhs.maxRequestsPerSecond;
     return *this;
 }
 
+const std::string ROCKY_NAMESPACE::RAW_IMAGE_CONTENT_TYPE = "image/x-rocky-raw";
+
+namespace
+{
+    struct RawImageHeader
+    {
+        char magic[4] = { 'R', 'K', 'Y', '1' };
+        std::uint32_t format = 0, width = 0, height = 0, depth = 0;
+    };
+}
+
+Status
+ROCKY_NAMESPACE::writeRawImage(const Image& image, std::ostream& out)
+{
+    if (!image.valid())
+        return Status(Status::AssertionFailure, "Invalid image");
+
+    RawImageHeader header;
+    header.format = (std::uint32_t)image.pixelFormat();
+    header.width = image.width();
+    header.height = image.height();
+    header.depth = image.depth();
+
+    out.write((const char*)&header, sizeof(header));
+    out.write(image.data<char>(), image.sizeInBytes());
+    return out.good() ? StatusOK : Status(Status::GeneralError, "Failed to write image");
+}
+
+Result<shared_ptr<Image>>
+ROCKY_NAMESPACE::readRawImage(std::istream& in)
+{
+    auto start = in.tellg();
+
+    RawImageHeader expected, header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0)
+    {
+        in.clear();
+        in.seekg(start);
+        return Status(Status::ResourceUnavailable, "Not a raw image");
+    }
+
+    if (header.format >= (std::uint32_t)Image::NUM_PIXEL_FORMATS ||
+        header.width == 0 || header.height == 0 || header.depth == 0)
+    {
+        return Status(Status::GeneralError, "Corrupt raw image");
+    }
+
+    // check the size against what's left in the stream before allocating anything
+    auto pixels = in.tellg();
+    in.seekg(0, std::ios_base::end);
+    auto remaining = (std::uint64_t)(in.tellg() - pixels);
+    in.seekg(pixels);
+
+    auto pixelSize = (std::uint64_t)Image::create((Image::PixelFormat)header.format, 1, 1, 1)->sizeInBytes();
+    if ((std::uint64_t)header.width * header.height * header.depth * pixelSize != remaining)
+    {
+        return Status(Status::GeneralError, "Corrupt raw image");
+    }
+
+    auto image = Image::create((Image::PixelFormat)header.format, header.width, header.height, header.depth);
+    if (!in.read(image->data<char>(), image->sizeInBytes()))
+    {
+        return Status(Status::GeneralError, "Corrupt raw image");
+    }
+
+    return image;
+}
+
 namespace
 {
     ReadImageURIService default_read_image_from_uri = [](const std::string&, const IOOptions&) { return Status(Status::ServiceUnavailable); };
-    ReadImageStreamService default_read_image_from_stream = [](std::istream&, const std::string&, const IOOptions&) { return Status(Status::ServiceUnavailable); };
+
+    // with no image codecs installed, only the raw image format is available
+    ReadImageStreamService default_read_image_from_stream = [](std::istream& in, const std::string& contentType, const IOOptions&)
+        -> Result<shared_ptr<Image>>
+        {
+            if (contentType.empty() || contentType == RAW_IMAGE_CONTENT_TYPE)
+            {
+                auto r = readRawImage(in);
+                if (r.status.code != Status::ResourceUnavailable)
+                    return r;
+            }
+            return Status(Status::ServiceUnavailable, "No image reader for \"" + contentType + "\"");
+        };
+
+    WriteImageStreamService default_write_image_to_stream = [](shared_ptr<Image> image, std::ostream& out, const std::string& contentType, const IOOptions&)
+        -> Status
+        {
+            if (!image)
+                return Status(Status::AssertionFailure);
+            if (contentType == RAW_IMAGE_CONTENT_TYPE)
+                return writeRawImage(*image, out);
+            return Status(Status::ServiceUnavailable, "No image writer for \"" + contentType + "\"");
+        };
+
     CacheService default_cache = []() { return nullptr; };
 }
 
 Services::Services() :
     readImageFromURI(default_read_image_from_uri),
     readImageFromStream(default_read_image_from_stream),
+    writeImageToStream(default_write_image_to_stream),
     cache(default_cache)
 {
     //nop
 }
 
+//------------------------------------------------------------------------
+
+ByteBuffer::ByteBuffer(std::string value)
+{
+    auto owner = std::make_shared<const std::string>(std::move(value));
+    _data = owner->data();
+    _size = owner->size();
+    _owner = owner;
+}
+
+Result<ByteBuffer>
+ByteBuffer::map(const std::string& filename)
+{
+    ByteBuffer buffer;
+
+#ifdef _WIN32
+
+    HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return Result<ByteBuffer>(Status::ResourceUnavailable, "Cannot open " + filename);
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size))
+    {
+        ::CloseHandle(file);
+        return Result<ByteBuffer>(Status::GeneralError, "Cannot read size of " + filename);
+    }
+
+    // can't map an empty file
+    if (size.QuadPart == 0)
+    {
+        ::CloseHandle(file);
+        return buffer;
+    }
+
+    HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(file);
+    if (mapping == nullptr)
+        return Result<ByteBuffer>(Status::GeneralError, "Cannot map " + filename);
+
+    void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(mapping);
+    if (view == nullptr)
+        return Result<ByteBuffer>(Status::GeneralError, "Cannot map " + filename);
+
+    buffer._data = static_cast<const char*>(view);
+    buffer._size = (std::size_t)size.QuadPart;
+    buffer._owner = shared_ptr<const void>(view, [](const void* p) { ::UnmapViewOfFile(p); });
+
+#else
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return Result<ByteBuffer>(Status::ResourceUnavailable, "Cannot open " + filename);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return Result<ByteBuffer>(Status::GeneralError, "Cannot read size of " + filename);
+    }
+
+    // can't map an empty file
+    std::size_t size = (std::size_t)info.st_size;
+    if (size == 0)
+    {
+        ::close(fd);
+        return buffer;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void* view = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+        return Result<ByteBuffer>(Status::GeneralError, "Cannot map " + filename);
+
+    buffer._data = static_cast<const char*>(view);
+    buffer._size = size;
+    buffer._owner = shared_ptr<const void>(view, [size](const void* p) { ::munmap(const_cast<void*>(p), size); });
+
+#endif
+
+    return buffer;
+}
+
+detail::ByteBufferStreambuf::ByteBufferStreambuf(const ByteBuffer& buffer) :
+    _buffer(buffer)
+{
+    // the get area only reads, so casting away const is safe
+    char* begin = const_cast<char*>(_buffer.data());
+    setg(begin, begin, begin + _buffer.size());
+}
+
+std::streampos
+detail::ByteBufferStreambuf::seekoff(std::streamoff off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    std::streamoff base =
+        dir == std::ios_base::beg ? 0 :
+        dir == std::ios_base::cur ? (std::streamoff)(gptr() - eback()) :
+        (std::streamoff)(egptr() - eback());
+
+    return seekpos(std::streampos(base + off), which);
+}
+
+std::streampos
+detail::ByteBufferStreambuf::seekpos(std::streampos pos, std::ios_base::openmode which)
+{
+    std::streamoff offset = (std::streamoff)pos;
+    if ((which & std::ios_base::in) == 0 || offset < 0 || offset > (std::streamoff)(egptr() - eback()))
+        return std::streampos(std::streamoff(-1));
+
+    setg(eback(), eback() + offset, egptr());
+    return pos;
+}
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    // approximate memory held by a content cache entry
+    std::size_t content_cost(const std::string& key, const Result<Content>& entry)
+    {
+        return sizeof(entry) + key.size() + entry.value.contentType.size() + entry.value.data.size() +
+            entry.value.etag.size() + entry.value.lastModified.size();
+    }
+}
+
+ContentCache::ContentCache(std::size_t budgetBytes) :
+    util::ShardedLRUCache<std::string, Result<Content>>(budgetBytes, content_cost)
+{
+    //nop
+}
+
+
+//------------------------------------------------------------------------
+
+ConnectionPool::Lease&
+ConnectionPool::Lease::operator = (Lease&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        release();
+        _pool = rhs._pool;
+        _key = std::move(rhs._key);
+        _connection = std::move(rhs._connection);
+        _reusable = rhs._reusable;
+        _fresh = rhs._fresh;
+        rhs._pool = nullptr;
+    }
+    return *this;
+}
+
+void
+ConnectionPool::Lease::release()
+{
+    if (_pool)
+    {
+        _pool->put(_key, std::move(_connection), _reusable);
+        _pool = nullptr;
+    }
+}
+
+ConnectionPool::Lease
+ConnectionPool::acquire(const std::string& key, const Factory& factory, const Cancelable* cancelable, unsigned limit)
+{
+    Lease lease;
+
+    unsigned max_active = std::max(maxConnectionsPerHost, 1u);
+    if (limit > 0u)
+        max_active = std::min(max_active, limit);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;)
+    {
+        std::vector<std::unique_ptr<Connection>> expired;
+        expire(Clock::now(), expired);
+        if (!expired.empty())
+        {
+            // closing can block on the network, so do it outside the lock
+            lock.unlock();
+            expired.clear();
+            lock.lock();
+        }
+
+        auto& host = _hosts[key];
+
+        if (!host.idle.empty() && host.active < max_active)
+        {
+            // reuse the most recently returned connection; it's the likeliest to still be open
+            lease._connection = std::move(host.idle.back().first);
+            host.idle.pop_back();
+            ++host.active;
+            ++reused;
+            break;
+        }
+
+        if (host.active < max_active)
+        {
+            // reserve the slot, then connect without holding the lock
+            ++host.active;
+            lock.unlock();
+            lease._connection = factory ? factory(key) : nullptr;
+            lock.lock();
+
+            if (!lease._connection)
+            {
+                --host.active;
+                host.released.notify_all();
+                return lease;
+            }
+
+            ++created;
+            lease._fresh = true;
+            break;
+        }
+
+        if (cancelable && cancelable->canceled())
+            return lease;
+
+        // poll so we notice cancelation
+        host.released.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    lease._pool = this;
+    lease._key = key;
+    lease._reusable = true;
+    return lease;
+}
+
+void
+ConnectionPool::put(const std::string& key, std::unique_ptr<Connection> connection, bool reusable)
+{
+    std::unique_ptr<Connection> discarded;
+    Host* host = nullptr;
+    {
+        std::scoped_lock lock(_mutex);
+        host = &_hosts[key];
+        if (host->active > 0)
+            --host->active;
+
+        if (connection && reusable && idleTimeout.count() > 0)
+            host->idle.emplace_back(std::move(connection), Clock::now());
+        else
+            discarded = std::move(connection);
+    }
+    host->released.notify_all();
+
+    // discarded connection closes here, outside the lock
+}
+
+void
+ConnectionPool::expire(Clock::time_point now, std::vector<std::unique_ptr<Connection>>& expired)
+{
+    // call with _mutex locked
+    for (auto& [key, host] : _hosts)
+    {
+        // idle lists are in return order, so the expired ones are at the front
+        auto i = host.idle.begin();
+        while (i != host.idle.end() && now - i->second >= idleTimeout)
+        {
+            expired.emplace_back(std::move(i->first));
+            ++i;
+        }
+        host.idle.erase(host.idle.begin(), i);
+    }
+}
+
+unsigned
+ConnectionPool::idle() const
+{
+    std::scoped_lock lock(_mutex);
+    unsigned count = 0u;
+    for (auto& [key, host] : _hosts)
+        count += (unsigned)host.idle.size();
+    return count;
+}
+
+void
+ConnectionPool::clear()
+{
+    std::vector<std::unique_ptr<Connection>> discarded;
+    {
+        std::scoped_lock lock(_mutex);
+        for (auto& [key, host] : _hosts)
+        {
+            for (auto& entry : host.idle)
+                discarded.emplace_back(std::move(entry.first));
+            host.idle.clear();
+        }
+    }
+
+    // discarded connections close here, outside the lock
+}
+
+//------------------------------------------------------------------------
+
+bool
+RateLimiter::acquire(const std::string& key, double requestsPerSecond, const Cancelable* cancelable)
+{
+    for (;;)
+    {
+        Clock::duration wait(0);
+        {
+            std::scoped_lock lock(_mutex);
+            auto now = Clock::now();
+            auto& bucket = _buckets[key];
+
+            if (!bucket.initialized)
+            {
+                bucket.tokens = std::max(1.0, requestsPerSecond);
+                bucket.refilled = now;
+                bucket.initialized = true;
+            }
+
+            if (now < bucket.pausedUntil)
+            {
+                wait = bucket.pausedUntil - now;
+            }
+            else if (requestsPerSecond <= 0.0)
+            {
+                return true;
+            }
+            else
+            {
+                // refill for the time since the last request, up to one second's worth
+                double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+                bucket.tokens = std::min(std::max(1.0, requestsPerSecond), bucket.tokens + elapsed * requestsPerSecond);
+                bucket.refilled = now;
+
+                if (bucket.tokens >= 1.0)
+                {
+                    bucket.tokens -= 1.0;
+                    return true;
+                }
+
+                wait = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>((1.0 - bucket.tokens) / requestsPerSecond));
+            }
+        }
+
+        if (cancelable && cancelable->canceled())
+            return false;
+
+        // sleep in short steps so we notice cancelation
+        std::this_thread::sleep_for(std::min(wait, Clock::duration(std::chrono::milliseconds(100))));
+    }
+}
+
+void
+RateLimiter::pause(const std::string& key, Clock::time_point until)
+{
+    std::scoped_lock lock(_mutex);
+    auto& bucket = _buckets[key];
+    bucket.pausedUntil = std::max(bucket.pausedUntil, until);
+}
@@ -9,6 +9,14 @@
 #include <rocky/Log.h>
 #include <rocky/Status.h>
 #include <rocky/Units.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <istream>
+#include <ostream>
+#include <string_view>
 
 /**
  * A collection of types used by the various I/O systems.
@@ -16,6 +24,7 @@
 namespace ROCKY_NAMESPACE
 {
     class IOOptions;
+    class IOTracer;
     class Image;
     class Layer;
 
@@ -26,9 +35,40 @@ namespace ROCKY_NAMESPACE
         virtual bool canceled() const = 0;
     };
 
-    //! Base class for a cache
-    class Cache : public Inherit<Object, Cache>
+    /**
+     * Base class for a persistent cache.
+     * A record is a blob of data stored under a key, within a named bin
+     * (usually one bin per layer).
+     */
+    class ROCKY_EXPORT Cache : public Inherit<Object, Cache>
     {
+    public:
+        struct Record
+        {
+            std::string data;
+            TimeStamp lastModified = 0;
+        };
+
+        //! Read a record; fails with ResourceUnavailable if there isn't one
+        virtual Result<Record> read(const std::string& bin, const std::string& key) const = 0;
+
+        //! Time a record was written, without reading its data; fails with
+        //! ResourceUnavailable if there isn't one. The default reads the whole record.
+        virtual Result<TimeStamp> stat(const std::string& bin, const std::string& key) const {
+            auto r = read(bin, key);
+            if (r.status.failed())
+                return r.status;
+            return r.value.lastModified;
+        }
+
+        //! Write (or replace) a record
+        virtual Status write(const std::string& bin, const std::string& key, const std::string& data) = 0;
+
+        //! Remove a record
+        virtual Status remove(const std::string& bin, const std::string& key) = 0;
+
+        //! Remove all the records in a bin
+        virtual Status clear(const std::string& bin) = 0;
     };
 
     //! Service providing a Log
@@ -45,8 +85,7 @@ namespace ROCKY_NAMESPACE
         Status(shared_ptr<Image> image, std::ostream& stream, std::string contentType, const IOOptions& io)>;
 
     //! Service for caching data
-    using CacheImpl = void*; // todo.
-    using CacheService = std::function<shared_ptr<CacheImpl>()>;
+    using CacheService = std::function<shared_ptr<Cache>()>;
 
     //! Service for accessing other data
     class DataInterface {
@@ -55,12 +94,257 @@ namespace ROCKY_NAMESPACE
     };
     using DataService = std::function<DataInterface&()>;
 
+    /**
+     * Read-only block of bytes with shared ownership. The bytes live either
+     * in a std::string or in a read-only memory mapping of a file, so local
+     * files can be served without copying them. Copies share the same bytes.
+     */
+    class ROCKY_EXPORT ByteBuffer
+    {
+    public:
+        //! Empty buffer
+        ByteBuffer() = default;
+
+        //! Buffer that takes over a string
+        ByteBuffer(std::string value);
+
+        //! Buffer mapping a file's contents into memory. The file should not be
+        //! truncated while any copy of the buffer is alive.
+        static Result<ByteBuffer> map(const std::string& filename);
+
+        //! Pointer to the bytes (not null-terminated)
+        const char* data() const { return _data; }
+
+        //! Number of bytes
+        std::size_t size() const { return _size; }
+
+        bool empty() const { return _size == 0; }
+
+        const char* begin() const { return _data; }
+        const char* end() const { return _data + _size; }
+
+        //! View of the bytes
+        std::string_view view() const { return std::string_view(_data, _size); }
+
+        //! Copy of the bytes as a string
+        std::string str() const { return std::string(_data, _size); }
+
+        bool operator == (std::string_view rhs) const { return view() == rhs; }
+        bool operator != (std::string_view rhs) const { return view() != rhs; }
+
+    private:
+        shared_ptr<const void> _owner;
+        const char* _data = nullptr;
+        std::size_t _size = 0;
+    };
+
+    namespace detail
+    {
+        // stream buffer whose get area is a ByteBuffer's bytes
+        class ROCKY_EXPORT ByteBufferStreambuf : public std::streambuf
+        {
+        public:
+            ByteBufferStreambuf(const ByteBuffer& buffer);
+
+        protected:
+            std::streampos seekoff(std::streamoff off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+            std::streampos seekpos(std::streampos pos, std::ios_base::openmode which) override;
+
+        private:
+            ByteBuffer _buffer;
+        };
+    }
+
+    /**
+     * Input stream that reads a ByteBuffer in place.
+     */
+    class ROCKY_EXPORT ByteBufferStream : private detail::ByteBufferStreambuf, public std::istream
+    {
+    public:
+        ByteBufferStream(const ByteBuffer& buffer) :
+            detail::ByteBufferStreambuf(buffer),
+            std::istream(static_cast<detail::ByteBufferStreambuf*>(this)) { }
+    };
+
     struct Content {
         std::string contentType;
-        std::string data;
+        ByteBuffer data;
+        //! HTTP validators used to revalidate a cached copy with the server
+        std::string etag;
+        std::string lastModified;
+        //! Time at which a cached copy goes stale, or 0 if the server didn't say
+        TimeStamp expires = 0;
+    };
+
+    /**
+     * In-memory cache of recently fetched content, keyed by URI and limited
+     * by the approximate number of bytes it holds.
+     */
+    class ROCKY_EXPORT ContentCache : public util::ShardedLRUCache<std::string, Result<Content>>
+    {
+    public:
+        //! Construct a content cache
+        //! @param budgetBytes Maximum number of bytes to hold
+        ContentCache(std::size_t budgetBytes = 32u * 1024u * 1024u);
     };
 
-    using ContentCache = util::LRUCache<std::string, Result<Content>>;
+    /**
+     * Thread-safe pool of reusable (keep-alive) network connections,
+     * keyed by "scheme://host:port".
+     *
+     * acquire() hands out an idle connection for the key if there is one,
+     * or creates a new one, blocking while the key is at its connection limit.
+     * The returned Lease puts the connection back when it goes out of scope.
+     */
+    class ROCKY_EXPORT ConnectionPool
+    {
+    public:
+        //! Base class for a pooled connection
+        struct Connection
+        {
+            virtual ~Connection() { }
+        };
+
+        //! Function that opens a new connection for a key
+        using Factory = std::function<std::unique_ptr<Connection>(const std::string& key)>;
+
+        //! A connection checked out of the pool
+        class ROCKY_EXPORT Lease
+        {
+        public:
+            Lease() = default;
+            Lease(Lease&& rhs) noexcept { *this = std::move(rhs); }
+            Lease& operator = (Lease&& rhs) noexcept;
+            ~Lease() { release(); }
+
+            //! Whether the lease holds a connection
+            explicit operator bool() const { return _connection != nullptr; }
+
+            //! The connection
+            Connection* get() const { return _connection.get(); }
+
+            //! Close the connection instead of returning it to the pool,
+            //! e.g. after a network error leaves it in an unknown state
+            void discard() { _reusable = false; }
+
+            //! Return the connection to the pool now
+            void release();
+
+            //! Whether the connection was newly created for this lease
+            bool fresh() const { return _fresh; }
+
+        private:
+            ConnectionPool* _pool = nullptr;
+            std::string _key;
+            std::unique_ptr<Connection> _connection;
+            bool _reusable = true;
+            bool _fresh = false;
+            friend class ConnectionPool;
+        };
+
+        //! Maximum number of simultaneous connections to one key
+        unsigned maxConnectionsPerHost = 8u;
+
+        //! Idle connections older than this are closed instead of reused
+        std::chrono::milliseconds idleTimeout = std::chrono::seconds(30);
+
+        //! Number of connections opened, and number of times one was reused
+        std::atomic<unsigned> created = { 0u };
+        std::atomic<unsigned> reused = { 0u };
+
+        //! Check out a connection for a key, creating one with the factory if necessary.
+        //! Returns an empty lease if the factory fails or the operation is canceled
+        //! while waiting for a free connection.
+        //! @param limit Tighter cap on simultaneous connections to the key for this
+        //!    request, or 0 to use maxConnectionsPerHost
+        Lease acquire(const std::string& key, const Factory& factory, const Cancelable* cancelable = nullptr, unsigned limit = 0u);
+
+        //! Number of idle connections waiting in the pool
+        unsigned idle() const;
+
+        //! Close all idle connections
+        void clear();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Host
+        {
+            std::vector<std::pair<std::unique_ptr<Connection>, Clock::time_point>> idle;
+            unsigned active = 0u;
+            // per host, so a release only wakes those waiting for this host
+            // (all of them, since each may have its own limit)
+            std::condition_variable released;
+        };
+
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, Host> _hosts; // entries are never erased
+
+        void put(const std::string& key, std::unique_ptr<Connection> connection, bool reusable);
+        // moves expired idle connections to "expired" so the caller can close them after unlocking
+        void expire(Clock::time_point now, std::vector<std::unique_ptr<Connection>>& expired);
+    };
+
+    /**
+     * Thread-safe token-bucket limiter on the rate at which requests start,
+     * keyed by "scheme://host:port".
+     *
+     * Each key's bucket refills at the requested rate and holds up to one
+     * second's worth of requests, so short bursts go out immediately. A key
+     * can also be paused, e.g. when a server answers 429 with Retry-After.
+     */
+    class ROCKY_EXPORT RateLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        //! Wait until a request to a key may start.
+        //! @param key Host key
+        //! @param requestsPerSecond Rate limit for the key; 0 means no limit
+        //! @param cancelable Stops waiting when canceled
+        //! @return false if canceled while waiting
+        bool acquire(const std::string& key, double requestsPerSecond, const Cancelable* cancelable = nullptr);
+
+        //! Hold back all requests to a key until the given time
+        void pause(const std::string& key, Clock::time_point until);
+
+    private:
+        struct Bucket
+        {
+            double tokens = 0.0;
+            Clock::time_point refilled;
+            Clock::time_point pausedUntil;
+            bool initialized = false;
+        };
+
+        std::mutex _mutex;
+        std::unordered_map<std::string, Bucket> _buckets;
+    };
+
+    /**
+     * Running totals of HTTP traffic.
+     */
+    struct NetworkStats
+    {
+        //! Number of responses received
+        std::atomic<std::uint64_t> responses = { 0 };
+        //! Response body bytes as sent over the wire (possibly compressed)
+        std::atomic<std::uint64_t> bytesTransferred = { 0 };
+        //! Response body bytes after removing any content encoding
+        std::atomic<std::uint64_t> bytesDecoded = { 0 };
+    };
+
+    //! Content type of rocky's raw image format: a small header followed by the
+    //! pixels as they sit in memory. It stores any pixel format losslessly
+    //! (e.g. floating point heightfields) and needs no image codec.
+    extern ROCKY_EXPORT const std::string RAW_IMAGE_CONTENT_TYPE;
+
+    //! Writes an image in the raw image format
+    extern ROCKY_EXPORT Status writeRawImage(const Image& image, std::ostream& out);
+
+    //! Reads an image in the raw image format. Fails with ResourceUnavailable,
+    //! leaving the stream where it was, if the stream doesn't start with one.
+    extern ROCKY_EXPORT Result<shared_ptr<Image>> readRawImage(std::istream& in);
 
     class ROCKY_EXPORT Services
     {
@@ -70,7 +354,11 @@ namespace ROCKY_NAMESPACE
         ReadImageStreamService readImageFromStream;
         WriteImageStreamService writeImageToStream;
         CacheService cache;
-        shared_ptr<ContentCache> contentCache = std::make_shared<ContentCache>(128);
+        shared_ptr<ContentCache> contentCache = std::make_shared<ContentCache>();
+        shared_ptr<ConnectionPool> connectionPool = std::make_shared<ConnectionPool>();
+        shared_ptr<RateLimiter> rateLimiter = std::make_shared<RateLimiter>();
+        shared_ptr<NetworkStats> networkStats = std::make_shared<NetworkStats>();
+        shared_ptr<IOTracer> tracer; // optional; see IOTrace.h
     };
 
     // User options passed along with an IO context.
@@ -90,9 +378,17 @@ namespace ROCKY_NAMESPACE
         inline std::string property(const std::string& name) const;
         inline std::string& property(const std::string& name);
 
-        //! Maximum number of attempts to make a network connection
+        //! Maximum number of attempts to make a network request
         unsigned maxNetworkAttempts = 4u;
 
+        //! Maximum number of simultaneous requests to one host;
+        //! 0 uses the connection pool's limit
+        unsigned maxRequestsPerHost = 0u;
+
+        //! Maximum rate at which requests to one host may start, per second;
+        //! 0 means no limit
+        double maxRequestsPerSecond = 0.0;
+
         //! Was the current operation canceled?
         inline bool canceled() const override;
 
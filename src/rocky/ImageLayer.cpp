@@ -9,6 +9,7 @@
 #include "Color.h"
 #include "ImageMosaic.h"
 #include "IOTypes.h"
+#include "IOTrace.h"
 #include "Metrics.h"
 #include "Utils.h"
 #include "GeoImage.h"
@@ -129,7 +130,7 @@ ImageLayer::createImage(const TileKey& key, const IOOptions& io) const
         return Result(GeoImage::INVALID);
     }
 
-    //NetworkMonitor::ScopedRequestLayer layerRequest(getName());
+    IOTracer::Scope trace(io, name(), key.str());
 
     auto result = createImageInKeyProfile(key, io);
 
@@ -181,36 +182,51 @@ ImageLayer::createImageInKeyProfile(const TileKey& key, const IOOptions& io) con
         return Result(GeoImage::INVALID);
     }
 
-    // Tile gate prevents two threads from requesting the same key
-    // at the same time, which would be unnecessary work. Only lock
-    // the gate if there is an L2 cache active
-    ROCKY_TODO("Sentry");
-    //util::ScopedGate<TileKey> scopedGate(_sentry, key, [&]() {
-    //    return _memCache.valid();
-    //});
+    // Two threads requesting the same key at the same time would be
+    // unnecessary work, so later callers wait for and share the result
+    // of the request already in flight.
+    return _inflight.get(key, [&]()
+        {
+            Result<GeoImage> result;
 
-    Result<GeoImage> result;
+            // if this layer has no profile, just go straight to the driver.
+            if (!profile().valid())
+            {
+                std::shared_lock lock(layerStateMutex());
+                return createImageImplementation(key, io);
+            }
 
-    // if this layer has no profile, just go straight to the driver.
-    if (!profile().valid())
-    {
-        std::shared_lock lock(layerStateMutex());
-        return createImageImplementation(key, io);
-    }
+            // check the persistent cache first.
+            auto cached = readTileFromCache(key, io);
+            if (cached.status.ok())
+            {
+                return Result(GeoImage(cached.value, key.extent()));
+            }
+            else if (isCacheOnly())
+            {
+                return Result(GeoImage::INVALID);
+            }
 
-    else if (key.profile() == profile())
-    {
-        std::shared_lock lock(layerStateMutex());
-        result = createImageImplementation(key, io);
-    }
-    else
-    {
-        // If the profiles are different, use a compositing method to assemble the tile.
-        auto image = assembleImage(key, io);
-        result = GeoImage(image, key.extent());
-    }
+            if (key.profile() == profile())
+            {
+                std::shared_lock lock(layerStateMutex());
+                result = createImageImplementation(key, io);
+            }
+            else
+            {
+                // If the profiles are different, use a compositing method to assemble the tile.
+                auto image = assembleImage(key, io);
+                result = GeoImage(image, key.extent());
+            }
 
-    return result;
+            // Check for cancelation before writing to a cache
+            if (result.status.ok() && result.value.valid() && !io.canceled())
+            {
+                writeTileToCache(key, result.value.image(), io);
+            }
+
+            return result;
+        }, &io);
 }
 
 shared_ptr<Image>
@@ -9,6 +9,7 @@
 #include <rocky/TileLayer.h>
 #include <rocky/GeoImage.h>
 #include <rocky/Color.h>
+#include <rocky/Threading.h>
 
 namespace ROCKY_NAMESPACE
 {
@@ -49,6 +50,8 @@ namespace ROCKY_NAMESPACE
             const TileKey& key) const;
 
         //! Creates an image for the given tile key.
+        //! Simultaneous requests for the same key share one image, so
+        //! treat it as read-only (clone it to make changes).
         //! @param key TileKey for which to create an image
         //! @param progress Optional progress/cancelation callback
         Result<GeoImage> createImage(
@@ -138,6 +141,8 @@ namespace ROCKY_NAMESPACE
             const IOOptions& io) const;
 
         optional<bool> _coverage = false;
+
+        mutable util::Coalescer<TileKey, Result<GeoImage>> _inflight;
     };
 
 } // namespace ROCKY_NAMESPACE
@@ -4,6 +4,7 @@
  * MIT License
  */
 #include "Instance.h"
+#include "FileCache.h"
 #include "Profile.h"
 #include "SRS.h"
 #include "Threading.h"
@@ -111,6 +112,15 @@ Instance::Instance()
         Log::warn() << "Environment variable PROJ_DATA is not set" << std::endl;
     }
 
+    // Persistent tile cache location
+    const char* cachePath = ::getenv("ROCKY_CACHE_PATH");
+    if (cachePath)
+    {
+        auto cache = FileCache::create(std::string(cachePath));
+        _impl->ioOptions.services().cache = [cache]() { return cache; };
+        Log::info() << "Using tile cache at " << cachePath << std::endl;
+    }
+
     _global_status = StatusOK;
 }
 
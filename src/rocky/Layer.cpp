@@ -38,6 +38,8 @@ Layer::construct(const JSON& conf)
     get_to(j, "open", _openAutomatically);
     get_to(j, "attribution", _attribution);
     get_to(j, "l2_cache_size", _l2cachesize);
+    get_to(j, "cache_id", _cacheid);
+    get_to(j, "cache_policy", _cachePolicy);
 
     _status = Status(
         Status::ResourceUnavailable,
@@ -53,6 +55,8 @@ Layer::to_json() const
     set(j, "open", _openAutomatically);
     set(j, "attribution", _attribution);
     set(j, "l2_cache_size", _l2cachesize);
+    set(j, "cache_id", _cacheid);
+    set(j, "cache_policy", _cachePolicy);
     return j.dump();
 }
 
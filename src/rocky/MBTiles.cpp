@@ -7,6 +7,7 @@
 #include "Image.h"
 #include "json.h"
 #include "Instance.h"
+#include <algorithm>
 #include <filesystem>
 
 #include <sqlite3.h>
@@ -17,7 +18,92 @@ using namespace ROCKY_NAMESPACE;
 #undef LC
 #define LC "[MBTiles] "
 
+namespace
+{
+    const std::string SELECT_TILE_SQL =
+        "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
+
+    const std::string INSERT_TILE_SQL =
+        "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)";
+
+    // Past this many tiles the availability index costs more memory (8 bytes
+    // a tile) than it's worth, and we fall back on querying.
+    const std::size_t MAX_INDEXED_TILES = 8000000u;
 
+    // Train a zstd dictionary once we hold this many bytes of samples
+    // (zstd suggests ~100x the dictionary size) or this many tiles.
+    const std::size_t TRAINING_BYTES_PER_DICTIONARY_BYTE = 100u;
+    const std::size_t MAX_TRAINING_TILES = 1000u;
+
+    inline std::uint64_t pack(unsigned x, unsigned y)
+    {
+        return ((std::uint64_t)x << 32) | (std::uint64_t)y;
+    }
+
+    // the metadata table holds text, so binary values go in as hex
+    std::string to_hex(const std::string& data)
+    {
+        const char* digits = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(data.size() * 2);
+        for (unsigned char c : data)
+        {
+            hex.push_back(digits[c >> 4]);
+            hex.push_back(digits[c & 0xf]);
+        }
+        return hex;
+    }
+
+    std::string from_hex(const std::string& hex)
+    {
+        auto nibble = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+        std::string data;
+        data.reserve(hex.size() / 2);
+        for (std::size_t i = 0; i + 1 < hex.size(); i += 2)
+        {
+            data.push_back((char)((nibble(hex[i]) << 4) | nibble(hex[i + 1])));
+        }
+        return data;
+    }
+
+    bool put_metadata(sqlite3* database, const std::string& key, const std::string& value)
+    {
+        // prep the insert statement.
+        sqlite3_stmt* insert = 0L;
+        std::string query = "INSERT OR REPLACE INTO metadata (name,value) VALUES (?,?)";
+        if (SQLITE_OK != sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L))
+        {
+            Log::warn() << LC << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database) << std::endl;
+            return false;
+        }
+
+        // bind the values:
+        if (SQLITE_OK != sqlite3_bind_text(insert, 1, key.c_str(), key.length(), SQLITE_STATIC))
+        {
+            Log::warn() << LC << "Failed to bind text: " << query << "; " << sqlite3_errmsg(database) << std::endl;
+            return false;
+        }
+        if (SQLITE_OK != sqlite3_bind_text(insert, 2, value.c_str(), value.length(), SQLITE_STATIC))
+        {
+            Log::warn() << LC << "Failed to bind text: " << query << "; " << sqlite3_errmsg(database) << std::endl;
+            return false;
+        }
+
+        // execute the sql. no idea what a good return value should be :/
+        sqlite3_step(insert);
+        sqlite3_finalize(insert);
+        return true;
+    }
+
+    bool compress_tile(const util::StreamCompressor& compressor, std::string& value)
+    {
+        std::ostringstream output;
+        if (!compressor.compress(value, output))
+            return false;
+        value = output.str();
+        return true;
+    }
+}
 
 MBTiles::Driver::Driver() :
     _minLevel(0),
@@ -36,14 +122,116 @@ MBTiles::Driver::~Driver()
 void
 MBTiles::Driver::close()
 {
+    {
+        std::scoped_lock lock(_readersMutex);
+        for (auto& reader : _readers)
+        {
+            sqlite3_finalize((sqlite3_stmt*)reader.select);
+            sqlite3_close_v2((sqlite3*)reader.database);
+        }
+        _readers.clear();
+
+        // readers still out will close when they come back
+        ++_generation;
+    }
+
+    std::scoped_lock lock(_mutex);
+
+    if (_database != nullptr)
+    {
+        if (_training && !_pendingTiles.empty())
+        {
+            trainDictionary();
+        }
+        commitBatch();
+    }
+
+    _pendingTiles.clear();
+    _pendingBytes = 0u;
+    _training = false;
+    std::atomic_store(&_compressor, shared_ptr<util::StreamCompressor>());
+
+    _available.clear();
+    _indexed = false;
+
+    if (_insert != nullptr)
+    {
+        sqlite3_finalize((sqlite3_stmt*)_insert);
+        _insert = nullptr;
+    }
+
     if (_database != nullptr)
     {
         sqlite3* database = (sqlite3*)_database;
+
+        // fold the write-ahead log back into the database so it's a single
+        // self-contained file again (fails harmlessly if someone else has it open)
+        if (_wal)
+        {
+            sqlite3_exec(database, "PRAGMA journal_mode=DELETE", 0L, 0L, 0L);
+            _wal = false;
+        }
+
         sqlite3_close_v2(database);
         _database = nullptr;
     }
 }
 
+Status
+MBTiles::Driver::flush()
+{
+    std::scoped_lock lock(_mutex);
+
+    // no point waiting for more samples if the caller wants everything written
+    if (_training && !_pendingTiles.empty())
+    {
+        Status status = trainDictionary();
+        if (status.failed())
+            return status;
+    }
+
+    return commitBatch();
+}
+
+Status
+MBTiles::Driver::commitBatch() const
+{
+    // call with _mutex locked
+    if (_batchCount == 0u)
+        return StatusOK;
+
+    sqlite3* database = (sqlite3*)_database;
+
+    // a reader can hold us off past the busy timeout; try again like putTile does
+    int rc;
+    int tries = 0;
+    do {
+        rc = sqlite3_exec(database, "COMMIT", 0L, 0L, 0L);
+    } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
+
+    if (rc == SQLITE_OK)
+    {
+        _batchCount = 0u;
+        return StatusOK;
+    }
+
+    Status error(Status::GeneralError, util::make_string() << "Failed to commit tiles: " << sqlite3_errmsg(database));
+
+    // don't leave the transaction open, or every later BEGIN fails; the batch is lost.
+    // if even that fails, keep the count so the next write commits instead of beginning.
+    if (!sqlite3_get_autocommit(database))
+    {
+        sqlite3_exec(database, "ROLLBACK", 0L, 0L, 0L);
+    }
+
+    if (sqlite3_get_autocommit(database))
+    {
+        _batchCount = 0u;
+    }
+
+    return error;
+}
+
 Status
 MBTiles::Driver::open(
     const std::string& name,
@@ -54,8 +242,10 @@ MBTiles::Driver::open(
     const IOOptions& io)
 {
     _name = name;
+    _options = options;
 
     std::string fullFilename = options.uri->full();
+    _filename = fullFilename;
 
     bool readWrite = isWritingRequested;
 
@@ -97,6 +287,17 @@ MBTiles::Driver::open(
             << "Database \"" << fullFilename << "\": " << sqlite3_errmsg(database));
     }
 
+    // Batched writes: the write-ahead log keeps a commit down to a single sync,
+    // which is safe with synchronous=NORMAL, and lets readers in while we write.
+    if (readWrite && _options.batchSize.value() > 1u)
+    {
+        if (SQLITE_OK == sqlite3_exec((sqlite3*)_database, "PRAGMA journal_mode=WAL", 0L, 0L, 0L))
+        {
+            sqlite3_exec((sqlite3*)_database, "PRAGMA synchronous=NORMAL", 0L, 0L, 0L);
+            _wal = true;
+        }
+    }
+
     // New database setup:
     if (isNewDatabase)
     {
@@ -116,7 +317,31 @@ MBTiles::Driver::open(
         // compression?
         if (options.compress.has_value(true))
         {
-            putMetaData("compression", "zlib");
+            if (_options.compression == "zstd")
+            {
+                if (!util::ZStdCompressor::available())
+                {
+                    return Status(Status::ConfigurationError,
+                        "Cannot create database; zstd compression is not supported in this build");
+                }
+
+                // with a dictionary, hold off compressing until we've trained it
+                if (_options.dictionarySize.value() > 0u)
+                    _training = true;
+                else
+                    _compressor = std::make_shared<util::ZStdCompressor>();
+            }
+            else if (_options.compression == "zlib")
+            {
+                _compressor = std::make_shared<util::ZLibCompressor>();
+            }
+            else
+            {
+                return Status(Status::ConfigurationError,
+                    "Cannot create database; unsupported compression \"" + _options.compression.value() + "\"");
+            }
+
+            putMetaData("compression", _options.compression.value());
         }
 
         // initialize and update as we write tiles.
@@ -130,6 +355,12 @@ MBTiles::Driver::open(
         computeLevels();
         //Log::info() << "Got levels from database " << _minLevel << ", " << _maxLevel << std::endl;
 
+        // nothing will change underneath us, so we can index what's there
+        if (!readWrite)
+        {
+            buildAvailabilityIndex();
+        }
+
         std::string profileStr;
         getMetaData("profile", profileStr);
 
@@ -172,9 +403,34 @@ MBTiles::Driver::open(
         std::string compression;
         if (getMetaData("compression", compression))
         {
-            _options.compress = (compression == "zlib");
+            if (compression == "zlib")
+            {
+                _compressor = std::make_shared<util::ZLibCompressor>();
+            }
+            else if (compression == "zstd")
+            {
+                if (!util::ZStdCompressor::available())
+                {
+                    return Status(Status::ConfigurationError,
+                        "Database uses zstd compression, which is not supported in this build");
+                }
+
+                std::string dictionary;
+                getMetaData("zstd_dictionary", dictionary);
+                _compressor = std::make_shared<util::ZStdCompressor>(from_hex(dictionary));
+            }
+            else if (!compression.empty())
+            {
+                return Status(Status::ConfigurationError,
+                    "Database uses unsupported compression \"" + compression + "\"");
+            }
+
+            _options.compression = compression;
         }
 
+        // tiles are compressed (or not) the way the database says
+        _options.compress = (_compressor != nullptr);
+
 
         // Set the profile
         if (!profile.valid())
@@ -248,6 +504,9 @@ MBTiles::Driver::open(
         }
     }
 
+    // write tiles in the format of the database
+    _options.format = _tileFormat;
+
     // do we require RGB? for jpeg?
     _forceRGB =
         util::endsWith(_tileFormat, "jpg", false) ||
@@ -288,11 +547,169 @@ MBTiles::Driver::readMaxLevel()
     return result;
 }
 
+void
+MBTiles::Driver::buildAvailabilityIndex()
+{
+    _available.clear();
+    _indexed = false;
+
+    sqlite3* database = (sqlite3*)_database;
+
+    // only touches the tile index, not the tile data
+    sqlite3_stmt* select = nullptr;
+    std::string query = "SELECT zoom_level, tile_column, tile_row FROM tiles";
+    if (sqlite3_prepare_v2(database, query.c_str(), -1, &select, 0L) != SQLITE_OK)
+    {
+        Log::warn() << LC << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database) << std::endl;
+        return;
+    }
+
+    std::size_t count = 0u;
+    bool ok = true;
+    int rc;
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW)
+    {
+        int z = sqlite3_column_int(select, 0);
+        int x = sqlite3_column_int(select, 1);
+        int y = sqlite3_column_int(select, 2);
+
+        if (z < 0 || x < 0 || y < 0 || z > 64)
+            continue;
+
+        if (++count > MAX_INDEXED_TILES)
+        {
+            Log::info() << LC << _name << ": too many tiles to index; querying for each tile instead" << std::endl;
+            ok = false;
+            break;
+        }
+
+        if ((unsigned)z >= _available.size())
+            _available.resize(z + 1);
+
+        _available[z].push_back(pack(x, y));
+    }
+
+    sqlite3_finalize(select);
+
+    if (!ok || (rc != SQLITE_ROW && rc != SQLITE_DONE))
+    {
+        _available.clear();
+        return;
+    }
+
+    for (auto& level : _available)
+    {
+        std::sort(level.begin(), level.end());
+        level.shrink_to_fit();
+    }
+
+    _indexed = true;
+}
+
+bool
+MBTiles::Driver::isAvailable(unsigned z, unsigned x, unsigned y) const
+{
+    if (!_indexed)
+        return true;
+
+    if (z >= _available.size())
+        return false;
+
+    auto& level = _available[z];
+    return std::binary_search(level.begin(), level.end(), pack(x, y));
+}
+
+TileKey
+MBTiles::Driver::bestAvailableTileKey(const TileKey& key) const
+{
+    if (!_indexed || !key.valid())
+    {
+        return key;
+    }
+
+    // Walk up the ancestors. Tile counts double with each level, so an
+    // ancestor's column and row are the key's shifted right.
+    unsigned lod = key.levelOfDetail();
+    unsigned x = key.tileX(), y = key.tileY();
+
+    for (int z = (int)lod; z >= (int)_minLevel; --z)
+    {
+        unsigned shift = lod - (unsigned)z;
+        unsigned ax = x >> shift, ay = y >> shift;
+
+        // the database counts rows from the bottom
+        auto rows = key.profile().numTiles(z).second;
+        if (isAvailable(z, ax, rows - ay - 1))
+        {
+            return shift == 0 ? key : TileKey(z, ax, ay, key.profile());
+        }
+    }
+
+    return TileKey::INVALID;
+}
+
+Status
+MBTiles::Driver::acquireReader(Reader& reader) const
+{
+    {
+        std::scoped_lock lock(_readersMutex);
+        if (!_readers.empty())
+        {
+            reader = _readers.back();
+            _readers.pop_back();
+            return StatusOK;
+        }
+        reader.generation = _generation;
+    }
+
+    // None free, so open another one. Each reader is only used by one thread
+    // at a time, which lets it skip sqlite's internal locking.
+    sqlite3* database = nullptr;
+    int rc = sqlite3_open_v2(_filename.c_str(), &database, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, 0L);
+    if (rc != SQLITE_OK)
+    {
+        Status error(Status::ResourceUnavailable, util::make_string()
+            << "Database \"" << _filename << "\": " << sqlite3_errmsg(database));
+        sqlite3_close_v2(database);
+        return error;
+    }
+
+    // wait out a writer instead of failing right away
+    sqlite3_busy_timeout(database, 5000);
+
+    sqlite3_stmt* select = nullptr;
+    rc = sqlite3_prepare_v2(database, SELECT_TILE_SQL.c_str(), -1, &select, 0L);
+    if (rc != SQLITE_OK)
+    {
+        Status error(Status::GeneralError, util::make_string()
+            << "Failed to prepare SQL: " << SELECT_TILE_SQL << "; " << sqlite3_errmsg(database));
+        sqlite3_close_v2(database);
+        return error;
+    }
+
+    reader.database = database;
+    reader.select = select;
+    return StatusOK;
+}
+
+void
+MBTiles::Driver::releaseReader(Reader& reader) const
+{
+    std::scoped_lock lock(_readersMutex);
+    if (reader.generation == _generation)
+    {
+        _readers.push_back(reader);
+    }
+    else
+    {
+        sqlite3_finalize((sqlite3_stmt*)reader.select);
+        sqlite3_close_v2((sqlite3*)reader.database);
+    }
+}
+
 Result<shared_ptr<Image>>
 MBTiles::Driver::read(const TileKey& key, const IOOptions& io) const
 {
-    std::scoped_lock lock(_mutex);
-
     int z = key.levelOfDetail();
     int x = key.tileX();
     int y = key.tileY();
@@ -311,69 +728,74 @@ MBTiles::Driver::read(const TileKey& key, const IOOptions& io) const
     auto [numCols, numRows] = key.profile().numTiles(key.levelOfDetail());
     y = numRows - y - 1;
 
-    sqlite3* database = (sqlite3*)_database;
+    // don't bother asking for a tile we know isn't there
+    if (!isAvailable(z, x, y))
+    {
+        return Status(Status::ResourceUnavailable);
+    }
 
-    //Get the image
-    sqlite3_stmt* select = NULL;
-    std::string query = "SELECT tile_data from tiles where zoom_level = ? AND tile_column = ? AND tile_row = ?";
-    int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &select, 0L);
-    if (rc != SQLITE_OK)
+    Reader reader;
+    Status status = acquireReader(reader);
+    if (status.failed())
     {
-        return Status(Status::GeneralError, util::make_string()
-            << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        return status;
     }
 
-    bool valid = true;
+    sqlite3_stmt* select = (sqlite3_stmt*)reader.select;
 
     sqlite3_bind_int(select, 1, z);
     sqlite3_bind_int(select, 2, x);
     sqlite3_bind_int(select, 3, y);
 
-    Result<shared_ptr<Image>> result;
-    std::string errorMessage;
+    bool found = false;
+    std::string dataBuffer;
 
-    rc = sqlite3_step(select);
+    int rc = sqlite3_step(select);
     if (rc == SQLITE_ROW)
     {
         // the pointer returned from _blob gets freed internally by sqlite, supposedly
         const char* data = (const char*)sqlite3_column_blob(select, 0);
         int dataLen = sqlite3_column_bytes(select, 0);
 
-        std::string dataBuffer(data, dataLen);
+        dataBuffer.assign(data, dataLen);
+        found = true;
+    }
+    else if (rc != SQLITE_DONE)
+    {
+        status = Status(Status::GeneralError, util::make_string()
+            << "Failed query: " << SELECT_TILE_SQL << "; " << sqlite3_errmsg((sqlite3*)reader.database));
+    }
 
-        // decompress if necessary:
-        if (_options.compress == true)
-        {
-            std::istringstream inputStream(dataBuffer);
-            std::string value;
+    // ready the statement for the next read and return the connection
+    sqlite3_reset(select);
+    releaseReader(reader);
 
-            if (!util::ZLibCompressor().decompress(inputStream, value))
-            {
-                errorMessage = "Decompression failed";
-                valid = false;
-            }
-            else
-            {
-                dataBuffer = value;
-            }
-        }
-
-        // decode the raw image data:
-        if (valid)
-        {
-            std::istringstream inputStream(dataBuffer);
-            result = io.services().readImageFromStream(inputStream, {}, io);
-        }
+    if (status.failed())
+    {
+        return status;
     }
 
-    sqlite3_finalize(select);
+    if (!found)
+    {
+        return Status(Status::ResourceUnavailable);
+    }
 
-    if (!valid)
+    // decompress if necessary:
+    if (auto compressor = std::atomic_load(&_compressor))
     {
-        result = Status(Status::GeneralError, errorMessage);
+        std::string value;
+
+        if (!compressor->decompress(dataBuffer, value))
+        {
+            return Status(Status::GeneralError, "Decompression failed");
+        }
+
+        dataBuffer = std::move(value);
     }
 
-    return result;
+    // decode the raw image data:
+    std::istringstream inputStream(dataBuffer);
+    return io.services().readImageFromStream(inputStream, {}, io);
 }
 
 
@@ -386,7 +808,7 @@ MBTiles::Driver::write(const TileKey& key, shared_ptr<Image> input, const IOOpti
     if (!io.services().writeImageToStream)
         return Status(Status::ServiceUnavailable);
 
-    std::scoped_lock lock(_mutex);
+    // Encode and compress on the calling thread, and only lock for the database.
 
     // encode the data stream:
     std::stringstream buf;
@@ -415,14 +837,10 @@ MBTiles::Driver::write(const TileKey& key, shared_ptr<Image> input, const IOOpti
     std::string value = buf.str();
 
     // compress the buffer if necessary
-    if (_options.compress == true)
+    auto compressor = std::atomic_load(&_compressor);
+    if (compressor && !compress_tile(*compressor, value))
     {
-        std::ostringstream output;
-        if (!util::ZLibCompressor().compress(value, output))
-        {
-            return Status(Status::GeneralError, "Compressor failed");
-        }
-        value = output.str();
+        return Status(Status::GeneralError, "Compressor failed");
     }
 
     int z = key.levelOfDetail();
@@ -433,16 +851,94 @@ MBTiles::Driver::write(const TileKey& key, shared_ptr<Image> input, const IOOpti
     auto [numCols, numRows] = key.profile().numTiles(key.levelOfDetail());
     y = numRows - y - 1;
 
+    std::scoped_lock lock(_mutex);
+
+    Status status;
+
+    if (_options.compress == true && !compressor)
+    {
+        if (_training)
+        {
+            // hold the tile back until we have enough samples to train a dictionary
+            _pendingBytes += value.size();
+            _pendingTiles.push_back(PendingTile{ z, x, y, std::move(value) });
+
+            if (_pendingBytes >= TRAINING_BYTES_PER_DICTIONARY_BYTE * _options.dictionarySize.value() ||
+                _pendingTiles.size() >= MAX_TRAINING_TILES)
+            {
+                status = trainDictionary();
+            }
+        }
+        else
+        {
+            // the dictionary was trained while we were encoding
+            compressor = std::atomic_load(&_compressor);
+            if (compressor && compress_tile(*compressor, value))
+                status = insertTile(z, x, y, value);
+            else
+                status = Status(Status::GeneralError, "Compressor failed");
+        }
+    }
+    else
+    {
+        status = insertTile(z, x, y, value);
+    }
+
+    if (status.failed())
+    {
+        return status;
+    }
+
+    // adjust the max level if necessary
+    if (key.levelOfDetail() > _maxLevel)
+    {
+        _maxLevel = key.levelOfDetail();
+    }
+    if (key.levelOfDetail() < _minLevel)
+    {
+        _minLevel = key.levelOfDetail();
+    }
+
+    return StatusOK;
+}
+
+Status
+MBTiles::Driver::insertTile(int z, int x, int y, const std::string& value) const
+{
+    // call with _mutex locked
     sqlite3* database = (sqlite3*)_database;
+    const std::string& query = INSERT_TILE_SQL;
 
-    // Prep the insert statement:
-    sqlite3_stmt* insert = NULL;
-    std::string query = "INSERT OR REPLACE INTO tiles (zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)";
-    int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L);
-    if (rc != SQLITE_OK)
+    // Prep the insert statement once and reuse it:
+    if (_insert == nullptr)
+    {
+        sqlite3_stmt* insert = nullptr;
+        int rc = sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L);
+        if (rc != SQLITE_OK)
+        {
+            return Status(Status::GeneralError, util::make_string()
+                << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        }
+        _insert = insert;
+    }
+
+    sqlite3_stmt* insert = (sqlite3_stmt*)_insert;
+
+    // start a new batch if necessary:
+    bool batching = _options.batchSize.value() > 1u;
+    if (batching && _batchCount == 0u)
+    {
+        if (SQLITE_OK != sqlite3_exec(database, "BEGIN", 0L, 0L, 0L))
+        {
+            return Status(Status::GeneralError, util::make_string()
+                << "Failed to begin transaction; " << sqlite3_errmsg(database));
+        }
+        _batchStart = std::chrono::steady_clock::now();
+    }
+
+    if (batching)
     {
-        return Status(Status::GeneralError, util::make_string()
-            << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database));
+        ++_batchCount;
     }
 
     // bind parameters:
@@ -454,35 +950,77 @@ MBTiles::Driver::write(const TileKey& key, shared_ptr<Image> input, const IOOpti
     sqlite3_bind_blob(insert, 4, value.c_str(), value.length(), SQLITE_STATIC);
 
     // run the sql.
-    bool ok = true;
+    int rc;
     int tries = 0;
     do {
         rc = sqlite3_step(insert);
     } while (++tries < 100 && (rc == SQLITE_BUSY || rc == SQLITE_LOCKED));
 
+    // ready the statement for the next write; it no longer refers to our blob
+    sqlite3_reset(insert);
+    sqlite3_clear_bindings(insert);
+
     if (SQLITE_OK != rc && SQLITE_DONE != rc)
     {
 #if SQLITE_VERSION_NUMBER >= 3007015
         return Status(Status::GeneralError, util::make_string() << "Failed query: " << query << "(" << rc << ")" << sqlite3_errstr(rc) << "; " << sqlite3_errmsg(database));
 #else
-        return Status(Status::GeneralError, Stringify() << "Failed query: " << query << "(" << rc << ")" << rc << "; " << sqlite3_errmsg(database));
+        return Status(Status::GeneralError, util::make_string() << "Failed query: " << query << "(" << rc << ")" << rc << "; " << sqlite3_errmsg(database));
 #endif
-        ok = false;
     }
 
-    sqlite3_finalize(insert);
+    // commit the batch once it's full or old enough
+    if (batching)
+    {
+        auto age = std::chrono::duration<double>(std::chrono::steady_clock::now() - _batchStart).count();
+        if (_batchCount >= _options.batchSize.value() || age >= _options.flushInterval->as(Units::SECONDS))
+        {
+            return commitBatch();
+        }
+    }
 
-    // adjust the max level if necessary
-    if (key.levelOfDetail() > _maxLevel)
+    return StatusOK;
+}
+
+Status
+MBTiles::Driver::trainDictionary() const
+{
+    // call with _mutex locked
+    std::vector<std::string> samples;
+    samples.reserve(_pendingTiles.size());
+    for (auto& tile : _pendingTiles)
     {
-        _maxLevel = key.levelOfDetail();
+        samples.emplace_back(std::move(tile.data));
     }
-    if (key.levelOfDetail() < _minLevel)
+
+    auto dictionary = util::ZStdCompressor::train(samples, _options.dictionarySize.value());
+    if (dictionary.empty())
     {
-        _minLevel = key.levelOfDetail();
+        Log::warn() << LC << _name << ": could not train a zstd dictionary on "
+            << samples.size() << " tiles; compressing without one" << std::endl;
+    }
+    else
+    {
+        put_metadata((sqlite3*)_database, "zstd_dictionary", to_hex(dictionary));
     }
 
-    return StatusOK;
+    auto compressor = std::make_shared<util::ZStdCompressor>(dictionary);
+    std::atomic_store(&_compressor, shared_ptr<util::StreamCompressor>(compressor));
+    _training = false;
+
+    Status status;
+    for (std::size_t i = 0; i < samples.size() && status.ok(); ++i)
+    {
+        auto& tile = _pendingTiles[i];
+        if (compress_tile(*compressor, samples[i]))
+            status = insertTile(tile.z, tile.x, tile.y, samples[i]);
+        else
+            status = Status(Status::GeneralError, "Compressor failed");
+    }
+
+    _pendingTiles.clear();
+    _pendingBytes = 0u;
+    return status;
 }
 
 bool
@@ -526,34 +1064,7 @@ bool
 MBTiles::Driver::putMetaData(const std::string& key, const std::string& value)
 {
     std::scoped_lock lock(_mutex);
-
-    sqlite3* database = (sqlite3*)_database;
-
-    // prep the insert statement.
-    sqlite3_stmt* insert = 0L;
-    std::string query = "INSERT OR REPLACE INTO metadata (name,value) VALUES (?,?)";
-    if (SQLITE_OK != sqlite3_prepare_v2(database, query.c_str(), -1, &insert, 0L))
-    {
-        Log::warn() << LC << "Failed to prepare SQL: " << query << "; " << sqlite3_errmsg(database) << std::endl;
-        return false;
-    }
-
-    // bind the values:
-    if (SQLITE_OK != sqlite3_bind_text(insert, 1, key.c_str(), key.length(), SQLITE_STATIC))
-    {
-        Log::warn() << LC << "Failed to bind text: " << query << "; " << sqlite3_errmsg(database) << std::endl;
-        return false;
-    }
-    if (SQLITE_OK != sqlite3_bind_text(insert, 2, value.c_str(), value.length(), SQLITE_STATIC))
-    {
-        Log::warn() << LC << "Failed to bind text: " << query << "; " << sqlite3_errmsg(database) << std::endl;
-        return false;
-    }
-
-    // execute the sql. no idea what a good return value should be :/
-    sqlite3_step(insert);
-    sqlite3_finalize(insert);
-    return true;
+    return put_metadata((sqlite3*)_database, key, value);
 }
 
 void
@@ -8,11 +8,21 @@
 #include <rocky/Status.h>
 #include <rocky/URI.h>
 #include <rocky/TileKey.h>
+#include <rocky/Units.h>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 namespace ROCKY_NAMESPACE
 {
     class Image;
 
+    namespace util
+    {
+        class StreamCompressor;
+    }
+
     namespace MBTiles
     {
         /**
@@ -21,8 +31,27 @@ namespace ROCKY_NAMESPACE
         struct Options
         {
             optional<URI> uri;
-            optional<std::string> format = "image/png";
+            optional<std::string> format{ "image/png" };
             optional<bool> compress = false;
+
+            //! How to compress tiles when compress is set: "zlib" or "zstd".
+            //! An existing database keeps the method it was created with.
+            optional<std::string> compression{ "zlib" };
+
+            //! With zstd, train a dictionary of up to this many bytes on the
+            //! first tiles written to a new database, and store it in the
+            //! metadata. Shrinks small tiles the most. Zero means no dictionary.
+            //! Tiles written before training (or a flush) aren't readable yet.
+            optional<unsigned> dictionarySize = 0u;
+
+            //! Number of tile writes to group into one transaction. The default
+            //! of 1 commits every write; larger batches write much faster (the
+            //! database switches to WAL journaling) but other connections only
+            //! see the tiles once a batch commits.
+            optional<unsigned> batchSize = 1u;
+
+            //! Longest time a batch stays open before it commits, checked on each write
+            optional<Duration> flushInterval = Duration(5.0, Units::SECONDS);
         };
 
         /**
@@ -44,6 +73,9 @@ namespace ROCKY_NAMESPACE
 
             void close();
 
+            //! Commit any batched writes
+            Status flush();
+
             Result<shared_ptr<Image>> read(
                 const TileKey& key,
                 const IOOptions& io) const;
@@ -53,23 +85,80 @@ namespace ROCKY_NAMESPACE
                 shared_ptr<Image> image,
                 const IOOptions& io) const;
 
+            //! Deepest key at or above the input key that has a tile in the database,
+            //! or TileKey::INVALID if there isn't one. Answers from memory when the
+            //! database was opened read-only and indexed; otherwise returns the input key.
+            TileKey bestAvailableTileKey(const TileKey& key) const;
+
             void setDataExtents(const DataExtentList&);
             bool getMetaData(const std::string& name, std::string& value);
             bool putMetaData(const std::string& name, const std::string& value);
 
         private:
+            //! Read-only connection and its prepared tile query, used by
+            //! one thread at a time
+            struct Reader
+            {
+                void* database = nullptr;
+                void* select = nullptr;
+                unsigned generation = 0u;
+            };
+
             void* _database;
-            mutable unsigned _minLevel;
-            mutable unsigned _maxLevel;
+            mutable std::atomic<unsigned> _minLevel;
+            mutable std::atomic<unsigned> _maxLevel;
             shared_ptr<Image> _emptyImage;
             Options _options;
             std::string _tileFormat;
             bool _forceRGB;
             std::string _name;
 
+            std::string _filename;
+
+            // guards the main connection, which does the writing.
             // because no one knows if/when sqlite3 is threadsafe.
             mutable std::mutex _mutex;
+            mutable void* _insert = nullptr;
+
+            // open write transaction, if batching
+            mutable unsigned _batchCount = 0u;
+            mutable std::chrono::steady_clock::time_point _batchStart;
+            bool _wal = false;
+
+            // compresses tile data, or null for none. Use atomic_load/store,
+            // since training a dictionary sets it while others are reading.
+            mutable shared_ptr<util::StreamCompressor> _compressor;
+
+            // while training a zstd dictionary, the first tiles written wait
+            // here (uncompressed) until there are enough samples
+            struct PendingTile
+            {
+                int z, x, y;
+                std::string data;
+            };
+            mutable std::vector<PendingTile> _pendingTiles;
+            mutable std::size_t _pendingBytes = 0u;
+            mutable bool _training = false;
+
+            // pool of idle read connections; each is opened with SQLITE_OPEN_NOMUTEX
+            // and only ever used by the thread that took it from the pool.
+            mutable std::vector<Reader> _readers;
+            mutable std::mutex _readersMutex;
+            unsigned _generation = 0u;
+
+            // Tiles in the database by zoom level, as sorted (column << 32 | row)
+            // values, built at open for read-only databases. Lets us answer
+            // for missing tiles without a query.
+            std::vector<std::vector<std::uint64_t>> _available;
+            bool _indexed = false;
 
+            Status commitBatch() const;
+            Status insertTile(int z, int x, int y, const std::string& data) const;
+            Status trainDictionary() const;
+            void buildAvailabilityIndex();
+            bool isAvailable(unsigned z, unsigned x, unsigned y) const;
+            Status acquireReader(Reader& reader) const;
+            void releaseReader(Reader& reader) const;
             bool createTables();
             void computeLevels();
             Result<int> readMaxLevel();
@@ -27,6 +27,10 @@ MBTilesElevationLayer::construct(const JSON& conf)
     get_to(j, "uri", _options.uri);
     get_to(j, "format", _options.format);
     get_to(j, "compress", _options.compress);
+    get_to(j, "compression", _options.compression);
+    get_to(j, "dictionary_size", _options.dictionarySize);
+    get_to(j, "batch_size", _options.batchSize);
+    get_to(j, "flush_interval", _options.flushInterval);
 }
 
 JSON
@@ -36,6 +40,10 @@ MBTilesElevationLayer::to_json() const
     set(j, "uri", _options.uri);
     set(j, "format", _options.format);
     set(j, "compress", _options.compress);
+    set(j, "compression", _options.compression);
+    set(j, "dictionary_size", _options.dictionarySize);
+    set(j, "batch_size", _options.batchSize);
+    set(j, "flush_interval", _options.flushInterval);
     return j.dump();
 }
 
@@ -73,6 +81,26 @@ MBTilesElevationLayer::openImplementation(const IOOptions& io)
     return StatusOK;
 }
 
+TileKey
+MBTilesElevationLayer::bestAvailableTileKey(const TileKey& key, bool considerUpsampling) const
+{
+    auto best = super::bestAvailableTileKey(key, considerUpsampling);
+
+    // the index only knows about keys in the database's own profile
+    if (best.valid() && best.profile() == profile())
+    {
+        best = _driver.bestAvailableTileKey(best);
+    }
+
+    return best;
+}
+
+Status
+MBTilesElevationLayer::flush()
+{
+    return _driver.flush();
+}
+
 void
 MBTilesElevationLayer::closeImplementation()
 {
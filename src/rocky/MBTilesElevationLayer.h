@@ -35,9 +35,34 @@ namespace ROCKY_NAMESPACE
         void setCompress(bool value) { _options.compress = value; }
         optional<bool>& compress() { return _options.compress; }
 
+        //! Compression method, "zlib" or "zstd" (see MBTiles::Options)
+        void setCompression(const std::string& value) { _options.compression = value; }
+        optional<std::string>& compression() { return _options.compression; }
+
+        //! Size of the zstd dictionary to train for a new database; 0 for none
+        void setDictionarySize(unsigned value) { _options.dictionarySize = value; }
+        optional<unsigned>& dictionarySize() { return _options.dictionarySize; }
+
+        //! Number of tile writes to commit at once (see MBTiles::Options)
+        void setBatchSize(unsigned value) { _options.batchSize = value; }
+        optional<unsigned>& batchSize() { return _options.batchSize; }
+
+        //! Longest time to hold written tiles before committing them
+        void setFlushInterval(const Duration& value) { _options.flushInterval = value; }
+        optional<Duration>& flushInterval() { return _options.flushInterval; }
+
+        //! Commit any batched tile writes
+        Status flush();
+
         //! serialize
         JSON to_json() const override;
 
+        //! This layer can be opened for writing
+        bool isWritingSupported() const override { return true; }
+
+        //! Also consults the database's index of tiles, when it has one
+        TileKey bestAvailableTileKey(const TileKey& key, bool considerUpsampling = false) const override;
+
     protected:
 
         //! Creates a raster image for the given tile key
@@ -28,6 +28,10 @@ MBTilesImageLayer::construct(const JSON& conf)
     get_to(j, "uri", _options.uri);
     get_to(j, "format", _options.format);
     get_to(j, "compress", _options.compress);
+    get_to(j, "compression", _options.compression);
+    get_to(j, "dictionary_size", _options.dictionarySize);
+    get_to(j, "batch_size", _options.batchSize);
+    get_to(j, "flush_interval", _options.flushInterval);
 }
 
 JSON
@@ -37,6 +41,10 @@ MBTilesImageLayer::to_json() const
     set(j, "uri", _options.uri);
     set(j, "format", _options.format);
     set(j, "compress", _options.compress);
+    set(j, "compression", _options.compression);
+    set(j, "dictionary_size", _options.dictionarySize);
+    set(j, "batch_size", _options.batchSize);
+    set(j, "flush_interval", _options.flushInterval);
     return j.dump();
 }
 
@@ -74,6 +82,26 @@ MBTilesImageLayer::openImplementation(const IOOptions& io)
     return StatusOK;
 }
 
+TileKey
+MBTilesImageLayer::bestAvailableTileKey(const TileKey& key, bool considerUpsampling) const
+{
+    auto best = super::bestAvailableTileKey(key, considerUpsampling);
+
+    // the index only knows about keys in the database's own profile
+    if (best.valid() && best.profile() == profile())
+    {
+        best = _driver.bestAvailableTileKey(best);
+    }
+
+    return best;
+}
+
+Status
+MBTilesImageLayer::flush()
+{
+    return _driver.flush();
+}
+
 void
 MBTilesImageLayer::closeImplementation()
 {
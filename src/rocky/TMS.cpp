@@ -4,6 +4,7 @@
  * MIT License
  */
 #include "TMS.h"
+#include "IOTrace.h"
 
 #ifdef TINYXML_FOUND
 #include <tinyxml.h>
@@ -566,7 +567,7 @@ ROCKY_NAMESPACE::TMS::readTileMap(const URI& location, const IOOptions& io)
     if (r.status.failed())
         return r.status;
 
-    auto tilemap = parseTileMapFromXML(r->data);
+    auto tilemap = parseTileMapFromXML(r->data.str());
 
 #if 0
     // Read tile map into a Config:
@@ -735,29 +736,25 @@ TMS::Driver::read(
     const IOOptions& io) const
 {
     shared_ptr<Image> image;
-    URI imageURI;
 
     // create the URI from the tile map?
     if (tileMap.valid() && key.levelOfDetail() <= tileMap.maxLevel)
     {
-        imageURI = URI(tileMap.getURI(key, invertY), uri.context());
-        if (!imageURI.empty() && isMapboxRGB)
-        {
-            if (imageURI.full().find('?') == std::string::npos)
-                imageURI = URI(imageURI.full() + "?mapbox=true", uri.context());
-            else
-                imageURI = URI(imageURI.full() + "&mapbox=true", uri.context());
-        }
+        URI imageURI = createTileURI(uri, key, invertY, isMapboxRGB);
 
-        auto fetch = imageURI.read(io);
+        auto fetch = imageURI.read(withRequestLimits(io));
         if (fetch.status.failed())
         {
             return fetch.status;
         }
 
-        std::istringstream buf(fetch->data);
+        auto decoding = IOTracer::Clock::now();
+        ByteBufferStream buf(fetch->data);
         auto image_rr = io.services().readImageFromStream(buf, fetch->contentType, io);
 
+        if (auto* trace = IOTracer::current())
+            trace->time[IOTracer::DECODE] += IOTracer::Clock::now() - decoding;
+
         if (image_rr.status.failed())
         {
             return image_rr.status;
@@ -793,6 +790,50 @@ TMS::Driver::read(
 }
 
 
+Status
+TMS::Driver::fetch(
+    const URI& uri,
+    const TileKey& key,
+    bool invertY,
+    bool isMapboxRGB,
+    const IOOptions& io) const
+{
+    if (tileMap.valid() && key.levelOfDetail() <= tileMap.maxLevel)
+    {
+        URI imageURI = createTileURI(uri, key, invertY, isMapboxRGB);
+        if (!imageURI.empty())
+        {
+            return imageURI.read(withRequestLimits(io)).status;
+        }
+    }
+    return StatusOK;
+}
+
+IOOptions
+TMS::Driver::withRequestLimits(const IOOptions& io) const
+{
+    IOOptions limited(io);
+    if (maxRequestsPerHost > 0u)
+        limited.maxRequestsPerHost = maxRequestsPerHost;
+    if (maxRequestsPerSecond > 0.0)
+        limited.maxRequestsPerSecond = maxRequestsPerSecond;
+    return limited;
+}
+
+URI
+TMS::Driver::createTileURI(const URI& uri, const TileKey& key, bool invertY, bool isMapboxRGB) const
+{
+    URI imageURI(tileMap.getURI(key, invertY), uri.context());
+    if (!imageURI.empty() && isMapboxRGB)
+    {
+        if (imageURI.full().find('?') == std::string::npos)
+            imageURI = URI(imageURI.full() + "?mapbox=true", uri.context());
+        else
+            imageURI = URI(imageURI.full() + "&mapbox=true", uri.context());
+    }
+    return imageURI;
+}
+
 URI
 TMS::Driver::createSubstitutionURI(const TileKey& key, const URI& uri, bool invert_y) const
 {
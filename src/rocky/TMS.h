@@ -20,6 +20,8 @@ namespace ROCKY_NAMESPACE
             optional<std::string> tmsType;
             optional<std::string> format;
             optional<bool> coverage = false;
+            optional<unsigned> maxRequestsPerHost = 0u;
+            optional<double> maxRequestsPerSecond = 0.0;
         };
 
         struct TileFormat
@@ -123,6 +125,15 @@ namespace ROCKY_NAMESPACE
                 bool isMapboxRGB,
                 const IOOptions& io) const;
 
+            //! Fetches the raw tile data for a key into the I/O
+            //! content cache without decoding it.
+            Status fetch(
+                const URI& uri,
+                const TileKey& key,
+                bool invertY,
+                bool isMapboxRGB,
+                const IOOptions& io) const;
+
             bool write(
                 const URI& uri,
                 const TileKey& key,
@@ -133,12 +144,20 @@ namespace ROCKY_NAMESPACE
             //! Source information structure
             TileMap tileMap;
 
+            //! Limits on tile requests to the server (see IOOptions); 0 = no limit
+            unsigned maxRequestsPerHost = 0u;
+            double maxRequestsPerSecond = 0.0;
+
         private:
             bool _forceRGBWrites;
             bool _isCoverage;
 
             URI createSubstitutionURI(const TileKey& key, const URI& uri, bool invert_y) const;
 
+            URI createTileURI(const URI& uri, const TileKey& key, bool invertY, bool isMapboxRGB) const;
+
+            IOOptions withRequestLimits(const IOOptions& io) const;
+
             //bool resolveWriter(const std::string& format);
         };
     }
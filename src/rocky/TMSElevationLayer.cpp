@@ -36,6 +36,8 @@ TMSElevationLayer::construct(const JSON& conf)
     get_to(j, "uri", _options.uri);
     get_to(j, "tms_type", _options.tmsType);
     get_to(j, "format", _options.format);
+    get_to(j, "max_requests_per_host", _options.maxRequestsPerHost);
+    get_to(j, "max_requests_per_second", _options.maxRequestsPerSecond);
 }
 
 JSON
@@ -45,6 +47,8 @@ TMSElevationLayer::to_json() const
     set(j, "uri", _options.uri);
     set(j, "tms_type", _options.tmsType);
     set(j, "format", _options.format);
+    set(j, "max_requests_per_host", _options.maxRequestsPerHost);
+    set(j, "max_requests_per_second", _options.maxRequestsPerSecond);
     return j.dump();
 }
 
@@ -57,6 +61,9 @@ TMSElevationLayer::openImplementation(const IOOptions& io)
 
     Profile driver_profile = profile();
 
+    _driver.maxRequestsPerHost = maxRequestsPerHost();
+    _driver.maxRequestsPerSecond = maxRequestsPerSecond();
+
     DataExtentList dataExtents;
     Status status = _driver.open(
         uri(),
@@ -128,3 +135,11 @@ TMSElevationLayer::createHeightfieldImplementation(
         return r.status;
     }
 }
+
+Status
+TMSElevationLayer::prefetchImplementation(const TileKey& key, const IOOptions& io) const
+{
+    bool invertY = (tmsType() == "google");
+
+    return _driver.fetch(uri(), key, invertY, _encoding == Encoding::MapboxRGB, io);
+}
@@ -37,6 +37,14 @@ namespace ROCKY_NAMESPACE
         void setFormat(const std::string& value) { _options.format = value; }
         const optional<std::string>& format() const { return _options.format; }
 
+        //! Maximum number of simultaneous tile requests to the server (0 = no extra limit)
+        void setMaxRequestsPerHost(unsigned value) { _options.maxRequestsPerHost = value; }
+        const optional<unsigned>& maxRequestsPerHost() const { return _options.maxRequestsPerHost; }
+
+        //! Maximum rate of tile requests to the server, per second (0 = no limit)
+        void setMaxRequestsPerSecond(double value) { _options.maxRequestsPerSecond = value; }
+        const optional<double>& maxRequestsPerSecond() const { return _options.maxRequestsPerSecond; }
+
         //! Whether the layer contains coverage data
         void setCoverage(bool value) { _options.coverage = value; }
         const optional<bool>& coverage() const { return _options.coverage; }
@@ -53,6 +61,9 @@ namespace ROCKY_NAMESPACE
         //! Creates a raster image for the given tile key
         Result<GeoHeightfield> createHeightfieldImplementation(const TileKey& key, const IOOptions& io) const override;
 
+        //! Fetches the encoded tile for the given tile key
+        Status prefetchImplementation(const TileKey& key, const IOOptions& io) const override;
+
         //! Writes a raster image for he given tile key (if open for writing)
         //virtual Status writeImageImplementation(const TileKey& key, const osg::Image* image, ProgressCallback* progress) const override;
 
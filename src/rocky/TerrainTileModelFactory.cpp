@@ -15,21 +15,35 @@ using namespace ROCKY_NAMESPACE;
 
 namespace
 {
+    // Layers can hand the same heightfield to several callers (coalesced
+    // requests, the L2 cache), so this edits a copy and never the original.
     void replace_nodata_values(GeoHeightfield& geohf)
     {
         auto grid = geohf.heightfield();
         if (grid)
         {
+            shared_ptr<Heightfield> copy;
+
             for (unsigned col = 0; col < grid->height(); ++col)
             {
                 for (unsigned row = 0; row < grid->width(); ++row)
                 {
                     if (grid->heightAt(col, row) == NO_DATA_VALUE)
                     {
-                        grid->heightAt(col, row) = 0.0f;
+                        if (!copy)
+                        {
+                            auto image = grid->clone();
+                            copy = Heightfield::create(image.get());
+                        }
+                        copy->heightAt(col, row) = 0.0f;
                     }
                 }
             }
+
+            if (copy)
+            {
+                geohf = GeoHeightfield(copy, geohf.extent());
+            }
         }
     }
 }
@@ -159,6 +173,42 @@ TerrainTileModelFactory::createTileModel(
     return std::move(model);
 }
 
+void
+TerrainTileModelFactory::prefetchTileModel(
+    const Map* map,
+    const TileKey& key,
+    const CreateTileManifest& manifest,
+    const IOOptions& io) const
+{
+    ROCKY_PROFILING_ZONE;
+
+    for (auto& layer : map->layers().all())
+    {
+        if (io.canceled())
+            return;
+
+        if (!layer->isOpen() || !manifest.includes(layer.get()))
+            continue;
+
+        auto imageLayer = ImageLayer::cast(layer);
+        if (imageLayer &&
+            imageLayer->renderType() == imageLayer->RENDERTYPE_TERRAIN_SURFACE &&
+            imageLayer->intersects(key))
+        {
+            imageLayer->prefetch(key, io);
+        }
+    }
+
+    if (manifest.includesElevation())
+    {
+        auto layer = map->layers().firstOfType<ElevationLayer>();
+        if (layer && layer->isOpen())
+        {
+            layer->prefetch(key, io);
+        }
+    }
+}
+
 namespace
 {
     void addImageLayer(const TileKey& key, std::shared_ptr<ImageLayer> layer, bool fallback, TerrainTileModel& model, const IOOptions& io)
@@ -39,6 +39,19 @@ namespace ROCKY_NAMESPACE
             const CreateTileManifest& manifest,
             const IOOptions& io);
 
+        //! Fetches the raw data that createTileModel will need into the
+        //! I/O caches, without decoding or processing it. Call this from an
+        //! I/O-bound thread so that createTileModel is CPU-bound.
+        //! @param map Map from which to read source data
+        //! @param key Tile key for which to fetch data
+        //! @param manifest Set of layers for which to fetch data (empty => all layers)
+        //! @param io I/O options and cancelation callback
+        void prefetchTileModel(
+            const Map* map,
+            const TileKey& key,
+            const CreateTileManifest& manifest,
+            const IOOptions& io) const;
+
         TerrainTileModel::Elevation createElevationModel(
             const Map* map,
             const TileKey& key,
@@ -11,6 +11,7 @@
 
 #include <cstdlib>
 #include <climits>
+#include <exception>
 #include <mutex>
 #include <iomanip>
 
@@ -374,13 +375,15 @@ Semaphore::join(Cancelable& p)
 #define LC "[job_group]"
 
 job_group::job_group() :
-    _sema(std::make_shared<Semaphore>())
+    _sema(std::make_shared<Semaphore>()),
+    _canceled(std::make_shared<std::atomic_bool>(false))
 {
     //nop
 }
 
 job_group::job_group(const std::string& name) :
-    _sema(std::make_shared<Semaphore>(name))
+    _sema(std::make_shared<Semaphore>(name)),
+    _canceled(std::make_shared<std::atomic_bool>(false))
 {
     //nop
 }
@@ -403,38 +406,112 @@ job_group::join(Cancelable& p)
     }
 }
 
+void
+job_group::cancel()
+{
+    if (_canceled->exchange(true) == false)
+    {
+        // we don't know which schedulers our jobs are in, so sweep them all.
+        job_scheduler::sweepAll();
+    }
+}
+
+bool
+job_group::canceled() const
+{
+    return *_canceled;
+}
+
 
 #undef LC
 #define LC "[job] "
 
 
 void
-job::scheduler_dispatch(std::function<bool()> delegate, const job& config)
+job::scheduler_dispatch(std::function<bool()> delegate, std::function<bool()> canceled, const job& config)
 {
     job_scheduler* scheduler = config.scheduler ? config.scheduler : job_scheduler::get("");
 
     if (scheduler)
-        scheduler->dispatch(config, delegate);
+        scheduler->dispatch(config, delegate, canceled);
 }
 
 #undef LC
 #define LC "[job_scheduler] "
 
 // job_scheduler statics:
+// (metrics first, so they outlive the schedulers' threads at exit)
+job_metrics job_metrics::_singleton;
 std::mutex job_scheduler::_schedulers_mutex;
 std::unordered_map<std::string, std::shared_ptr<job_scheduler>> job_scheduler::_schedulers;
 std::unordered_map<std::string, unsigned> job_scheduler::_schedulersizes;
-job_metrics job_metrics::_singleton;
+std::unordered_map<std::string, job_scheduler::queue_mode> job_scheduler::_schedulermodes;
+std::unordered_map<std::string, std::pair<unsigned, unsigned>> job_scheduler::_scheduleradaptive;
 
 #define ROCKY_SCHEDULER_DEFAULT_SIZE 2u
+#define ROCKY_PARALLEL_SCHEDULER_NAME "rocky.parallel"
+#define ROCKY_SCHEDULER_DEFAULT_RESCORE_INTERVAL std::chrono::milliseconds(100)
+
+// adaptive concurrency: relative change in throughput that counts as better or worse
+#define ROCKY_SCHEDULER_ADAPT_TOLERANCE 0.05
+
+// adaptive concurrency: average queue wait below which we consider there to be no backlog
+#define ROCKY_SCHEDULER_ADAPT_MIN_WAIT std::chrono::milliseconds(1)
+
+namespace
+{
+    // the scheduler and worker index of the calling thread, if it's a worker
+    thread_local const job_scheduler* t_scheduler = nullptr;
+    thread_local unsigned t_worker = 0u;
+
+    // how long the job running on this thread waited in the queue
+    thread_local std::chrono::steady_clock::duration t_queueWait(0);
+    thread_local bool t_queueWaitTaken = false;
+}
 
-job_scheduler::job_scheduler(const std::string& name, unsigned concurrency) :
+std::chrono::steady_clock::duration
+job::queueWait()
+{
+    return t_queueWait;
+}
+
+std::chrono::steady_clock::duration
+job::takeQueueWait()
+{
+    if (t_queueWaitTaken)
+        return std::chrono::steady_clock::duration(0);
+    t_queueWaitTaken = true;
+    return t_queueWait;
+}
+
+job_scheduler::job_scheduler(const std::string& name, unsigned concurrency, queue_mode mode) :
     _name(name),
     _targetConcurrency(concurrency),
+    _queueMode(mode),
+    _rescoreInterval(std::chrono::steady_clock::duration(ROCKY_SCHEDULER_DEFAULT_RESCORE_INTERVAL).count()),
+    _lastRescore(std::chrono::steady_clock::now()),
+    _stealable(0u),
+    _sleepers(0u),
+    _nextLane(0u),
+    _adaptMin(0u),
+    _adaptMax(0u),
+    _adaptInterval(0),
+    _completed(0u),
+    _waits(0u),
+    _waitMicros(0u),
+    _adaptSampleStart(std::chrono::steady_clock::now()),
+    _lastThroughput(0.0),
+    _adaptDirection(1),
     _done(false)
 {
     // find a slot in the stats
     _metrics = &job_metrics::_singleton.scheduler(_name);
+
+    if (mode == queue_mode::stealing)
+    {
+        createLanes();
+    }
+
     startThreads();
 }
 
@@ -443,6 +520,17 @@ job_scheduler::~job_scheduler()
     stopThreads();
 }
 
+void
+job_scheduler::sweepAll()
+{
+    std::scoped_lock lock(_schedulers_mutex);
+    for (auto& iter : _schedulers)
+    {
+        if (iter.second)
+            iter.second->sweep();
+    }
+}
+
 void
 job_scheduler::shutdownAll()
 {
@@ -460,9 +548,21 @@ job_scheduler::get(const std::string& name)
     if (sched == nullptr)
     {
         auto iter = _schedulersizes.find(name);
-        unsigned numThreads = iter != _schedulersizes.end() ? iter->second : ROCKY_SCHEDULER_DEFAULT_SIZE;
+        unsigned numThreads =
+            iter != _schedulersizes.end() ? iter->second :
+            name == ROCKY_PARALLEL_SCHEDULER_NAME ? std::max(util::getConcurrency(), 2u) - 1u : // the caller is the other thread
+            ROCKY_SCHEDULER_DEFAULT_SIZE;
 
-        sched = std::make_shared<job_scheduler>(name, numThreads);
+        auto mode_iter = _schedulermodes.find(name);
+        queue_mode mode = mode_iter != _schedulermodes.end() ? mode_iter->second : queue_mode::scan;
+
+        sched = std::make_shared<job_scheduler>(name, numThreads, mode);
+
+        auto adaptive_iter = _scheduleradaptive.find(name);
+        if (adaptive_iter != _scheduleradaptive.end())
+        {
+            sched->setAdaptiveConcurrency(adaptive_iter->second.first, adaptive_iter->second.second);
+        }
     }
     return sched.get();
 }
@@ -507,32 +607,407 @@ job_scheduler::setConcurrency(const std::string& name, unsigned value)
     }
 }
 
+void
+job_scheduler::setQueueMode(queue_mode value)
+{
+    std::unique_lock lock(_queueMutex);
+    if (_queueMode != value)
+    {
+        // lanes must exist before any thread can see the stealing mode
+        if (value == queue_mode::stealing)
+        {
+            createLanes();
+        }
+
+        _queueMode = value;
+
+        // the queue is in arbitrary order in scan mode, so build the heap now.
+        if (_queueMode == queue_mode::heap)
+        {
+            rescore();
+        }
+
+        rebalance();
+        _block.notify_all();
+    }
+}
+
+void
+job_scheduler::setQueueMode(const std::string& name, queue_mode value)
+{
+    // this method exists so you can set an scheduler's queue mode
+    // before the scheduler is actually created
+
+    std::scoped_lock lock(_schedulers_mutex);
+    _schedulermodes[name] = value;
+
+    auto iter = _schedulers.find(name);
+    if (iter != _schedulers.end())
+    {
+        std::shared_ptr<job_scheduler> scheduler = iter->second;
+        ROCKY_SOFT_ASSERT_AND_RETURN(scheduler != nullptr, void());
+        scheduler->setQueueMode(value);
+    }
+}
+
+void
+job_scheduler::setAdaptiveConcurrency(unsigned minimum, unsigned maximum, std::chrono::milliseconds interval)
+{
+    std::scoped_lock lock(_adaptMutex);
+
+    minimum = std::max(minimum, 1u);
+    _adaptMin = minimum;
+    _adaptMax = maximum > 0 ? std::max(maximum, minimum) : 0u;
+    _adaptInterval = std::chrono::steady_clock::duration(interval).count();
+
+    // start a fresh sample
+    _completed = 0u;
+    _waits = 0u;
+    _waitMicros = 0u;
+    _adaptSampleStart = std::chrono::steady_clock::now();
+    _lastThroughput = 0.0;
+    _adaptDirection = 1;
+
+    if (_adaptMax > 0u)
+    {
+        setConcurrency(std::clamp(_targetConcurrency.load(), _adaptMin.load(), _adaptMax.load()));
+    }
+}
+
+void
+job_scheduler::setAdaptiveConcurrency(const std::string& name, unsigned minimum, unsigned maximum)
+{
+    // this method exists so you can turn on adaptive concurrency
+    // before the scheduler is actually created
+
+    std::scoped_lock lock(_schedulers_mutex);
+    _scheduleradaptive[name] = std::make_pair(minimum, maximum);
+
+    auto iter = _schedulers.find(name);
+    if (iter != _schedulers.end())
+    {
+        std::shared_ptr<job_scheduler> scheduler = iter->second;
+        ROCKY_SOFT_ASSERT_AND_RETURN(scheduler != nullptr, void());
+        scheduler->setAdaptiveConcurrency(minimum, maximum);
+    }
+}
+
+void
+job_scheduler::adapt()
+{
+    const auto interval = std::chrono::steady_clock::duration(_adaptInterval.load());
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = now - _adaptSampleStart;
+
+    if (elapsed < interval)
+        return;
+
+    unsigned completed = _completed.exchange(0u);
+    unsigned waits = _waits.exchange(0u);
+    std::uint64_t wait_micros = _waitMicros.exchange(0u);
+    _adaptSampleStart = now;
+
+    // If nobody called us for a long time the scheduler was idle,
+    // and this sample tells us nothing about the current workload.
+    if (elapsed > interval * 4)
+    {
+        _lastThroughput = 0.0;
+        return;
+    }
+
+    double throughput = (double)completed / std::chrono::duration<double>(elapsed).count();
+
+    // Jobs waiting in the queue means more threads might help.
+    auto min_wait = std::chrono::duration_cast<std::chrono::microseconds>(ROCKY_SCHEDULER_ADAPT_MIN_WAIT).count();
+    bool backlog = waits > 0 && (wait_micros / waits) >= (std::uint64_t)min_wait;
+
+    int step = _adaptDirection;
+
+    if (!backlog)
+    {
+        // Nothing is waiting, so extra threads can't help; shed one.
+        step = -1;
+    }
+    else if (_lastThroughput > 0.0 && throughput < _lastThroughput * (1.0 - ROCKY_SCHEDULER_ADAPT_TOLERANCE))
+    {
+        // The last step made things worse; go back the other way.
+        step = -_adaptDirection;
+    }
+    // Otherwise keep climbing in the same direction.
+
+    unsigned current = _targetConcurrency;
+    unsigned next = std::clamp((unsigned)std::max(1, (int)current + step), _adaptMin.load(), _adaptMax.load());
+
+    // At a limit? Turn around next time.
+    _adaptDirection = (next == current) ? -step : step;
+    _lastThroughput = throughput;
+
+    if (next != current)
+    {
+        std::scoped_lock lock(_quitMutex);
+        if (!_done)
+        {
+            _targetConcurrency = next;
+            resizeThreads();
+        }
+    }
+}
+
+job_scheduler::queue_mode
+job_scheduler::getQueueMode() const
+{
+    return _queueMode;
+}
+
+void
+job_scheduler::setRescoreInterval(std::chrono::milliseconds value)
+{
+    _rescoreInterval = std::chrono::steady_clock::duration(value).count();
+}
+
+unsigned
+job_scheduler::removeCanceled(std::vector<QueuedJob>& jobs)
+{
+    auto first_canceled = std::partition(jobs.begin(), jobs.end(),
+        [](const QueuedJob& queuedjob) { return !queuedjob.canceled(); });
+
+    unsigned count = std::distance(first_canceled, jobs.end());
+
+    for (auto iter = first_canceled; iter != jobs.end(); ++iter)
+    {
+        if (iter->_groupsema != nullptr)
+        {
+            iter->_groupsema->release();
+        }
+    }
+    jobs.erase(first_canceled, jobs.end());
+
+    _metrics->pending -= count;
+    _metrics->canceled += count;
+    return count;
+}
+
+unsigned
+job_scheduler::sweep()
+{
+    std::unique_lock lock(_queueMutex);
+
+    unsigned count = removeCanceled(_queue);
+
+    if (count > 0 && _queueMode == queue_mode::heap)
+    {
+        // cached priorities are still valid; just restore the heap.
+        std::make_heap(_queue.begin(), _queue.end());
+    }
+
+    for (auto& lane : _lanes)
+    {
+        std::scoped_lock lane_lock(lane->_mutex);
+        unsigned lane_count = removeCanceled(lane->_jobs);
+        if (lane_count > 0)
+        {
+            _stealable -= lane_count;
+            std::make_heap(lane->_jobs.begin(), lane->_jobs.end());
+            count += lane_count;
+        }
+    }
+
+    return count;
+}
+
+void
+job_scheduler::rescore()
+{
+    // no point in scoring jobs that no longer need to run
+    removeCanceled(_queue);
+
+    for (auto& queuedjob : _queue)
+    {
+        queuedjob._priority = queuedjob.evaluate();
+    }
+    std::make_heap(_queue.begin(), _queue.end());
+    _lastRescore = std::chrono::steady_clock::now();
+}
+
+void
+job_scheduler::createLanes()
+{
+    if (_lanes.empty())
+    {
+        // One lane per worker. If the concurrency grows past this later,
+        // workers will share lanes, which is still correct.
+        unsigned count = std::max(_targetConcurrency.load(), util::getConcurrency());
+        for (unsigned i = 0; i < count; ++i)
+        {
+            _lanes.emplace_back(std::make_unique<Lane>());
+        }
+    }
+}
+
+void
+job_scheduler::rebalance()
+{
+    if (_queueMode == queue_mode::stealing)
+    {
+        // Jobs left in the shared queue (by a mode change or by a dispatch
+        // that raced with one) go out to the lanes.
+        for (auto& queuedjob : _queue)
+        {
+            queuedjob._priority = queuedjob.evaluate();
+            Lane& lane = *_lanes[_nextLane++ % _lanes.size()];
+            std::scoped_lock lock(lane._mutex);
+            lane._jobs.emplace_back(std::move(queuedjob));
+            std::push_heap(lane._jobs.begin(), lane._jobs.end());
+            ++_stealable;
+        }
+        _queue.clear();
+    }
+
+    else if (_stealable > 0)
+    {
+        // Not stealing anymore; bring everything back to the shared queue.
+        for (auto& lane : _lanes)
+        {
+            std::scoped_lock lock(lane->_mutex);
+            _stealable -= lane->_jobs.size();
+            std::move(lane->_jobs.begin(), lane->_jobs.end(), std::back_inserter(_queue));
+            lane->_jobs.clear();
+        }
+
+        if (_queueMode == queue_mode::heap)
+        {
+            rescore();
+        }
+    }
+}
+
+bool
+job_scheduler::steal(QueuedJob& next)
+{
+    const unsigned count = _lanes.size();
+    const unsigned home = t_scheduler == this ? t_worker % count : 0u;
+    const auto interval = std::chrono::steady_clock::duration(_rescoreInterval.load());
+
+    // start with our own lane, then look at our neighbors'.
+    for (unsigned i = 0; i < count; ++i)
+    {
+        Lane& lane = *_lanes[(home + i) % count];
+        std::scoped_lock lock(lane._mutex);
+        if (!lane._jobs.empty())
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lane._lastRescore >= interval)
+            {
+                // drop canceled jobs while we're at it
+                _stealable -= removeCanceled(lane._jobs);
+                for (auto& queuedjob : lane._jobs)
+                    queuedjob._priority = queuedjob.evaluate();
+                std::make_heap(lane._jobs.begin(), lane._jobs.end());
+                lane._lastRescore = now;
+
+                if (lane._jobs.empty())
+                    continue;
+            }
+
+            std::pop_heap(lane._jobs.begin(), lane._jobs.end());
+            next = std::move(lane._jobs.back());
+            lane._jobs.pop_back();
+            --_stealable;
+            return true;
+        }
+    }
+    return false;
+}
+
 void
 job_scheduler::cancelAll()
 {
     std::unique_lock lock(_queueMutex);
     _queue.clear();
+    for (auto& lane : _lanes)
+    {
+        std::scoped_lock lane_lock(lane->_mutex);
+        _stealable -= lane->_jobs.size();
+        lane->_jobs.clear();
+    }
     _metrics->canceled += _metrics->pending;
     _metrics->pending = 0;
 }
 
 void
-job_scheduler::dispatch(const job& job, std::function<bool()>& delegate)
+job_scheduler::dispatch(const job& job, std::function<bool()>& delegate, std::function<bool()> canceled)
 {
-    // If we have a group semaphore, acquire it BEFORE queuing the job
     job_group* group = job.group;
+    std::shared_ptr<std::atomic_bool> groupcanceled = group ? group->_canceled : nullptr;
+    if (groupcanceled && *groupcanceled)
+    {
+        _metrics->canceled++;
+        return;
+    }
+
+    // If we have a group semaphore, acquire it BEFORE queuing the job
     std::shared_ptr<Semaphore> sema = group ? group->_sema : nullptr;
     if (sema)
     {
         sema->acquire();
     }
 
-    if (_targetConcurrency > 0)
+    if (_targetConcurrency > 0 && _queueMode == queue_mode::stealing)
+    {
+        QueuedJob entry(job, delegate, canceled, sema, groupcanceled);
+        entry._queued = std::chrono::steady_clock::now();
+        entry._priority = entry.evaluate();
+
+        // A worker keeps the jobs it spawns in its own lane; anyone else
+        // spreads them around.
+        unsigned index = t_scheduler == this ? t_worker : _nextLane++;
+        Lane& lane = *_lanes[index % _lanes.size()];
+
+        if (!_done)
+        {
+            _metrics->pending++;
+
+            std::scoped_lock lock(lane._mutex);
+            lane._jobs.emplace_back(std::move(entry));
+            std::push_heap(lane._jobs.begin(), lane._jobs.end());
+            ++_stealable;
+        }
+
+        // Only touch the shared mutex if someone is actually asleep. That
+        // includes workers waiting in another mode: if the mode changed after
+        // we read it, one of them has to wake up and rebalance this job.
+        if (_sleepers > 0)
+        {
+            std::unique_lock lock(_queueMutex);
+            _block.notify_one();
+        }
+    }
+    else if (_targetConcurrency > 0)
     {
+        QueuedJob entry(job, delegate, canceled, sema, groupcanceled);
+        entry._queued = std::chrono::steady_clock::now();
+
+        // In heap mode, evaluate the priority before taking the lock
+        // so we don't call user code while other threads wait.
+        bool scored = (_queueMode == queue_mode::heap);
+        if (scored)
+        {
+            entry._priority = entry.evaluate();
+        }
+
         std::unique_lock lock(_queueMutex);
         if (!_done)
         {
-            _queue.emplace_back(job, delegate, sema);
+            _queue.emplace_back(std::move(entry));
+
+            if (_queueMode == queue_mode::heap)
+            {
+                if (!scored)
+                    _queue.back()._priority = _queue.back().evaluate();
+
+                std::push_heap(_queue.begin(), _queue.end());
+            }
+
             _metrics->pending++;
             _block.notify_one();
         }
@@ -560,14 +1035,62 @@ job_scheduler::run()
         QueuedJob next;
 
         bool have_next = false;
+
+        if (_queueMode == queue_mode::stealing)
+        {
+            have_next = steal(next);
+
+            if (!have_next)
+            {
+                // Nothing anywhere; sleep until a dispatch wakes us up.
+                // _sleepers tells dispatchers that they need to notify.
+                std::unique_lock lock(_queueMutex);
+                ++_sleepers;
+                _block.wait(lock, [this] {
+                    return _stealable > 0 || _queue.empty() == false || _done == true;
+                    });
+                --_sleepers;
+                rebalance();
+            }
+        }
+        else
         {
             std::unique_lock lock(_queueMutex);
-            
+
+            // counted like the stealing sleepers, since a stealing dispatch
+            // may be what wakes us.
+            ++_sleepers;
             _block.wait(lock, [this] {
-                return _queue.empty() == false || _done == true;
+                return _queue.empty() == false || _stealable > 0 || _done == true;
                 });
+            --_sleepers;
 
-            if (!_queue.empty() && !_done)
+            rebalance();
+
+            if (_queueMode == queue_mode::scan && !_queue.empty())
+            {
+                // We're about to score every job anyway; drop the canceled
+                // ones first so we don't call their priority functions.
+                removeCanceled(_queue);
+            }
+
+            if (!_queue.empty() && !_done && _queueMode == queue_mode::heap)
+            {
+                // Priorities are dynamic, so the cached values go stale;
+                // refresh them all periodically instead of on every dequeue.
+                auto interval = std::chrono::steady_clock::duration(_rescoreInterval.load());
+                if (std::chrono::steady_clock::now() - _lastRescore >= interval)
+                {
+                    rescore();
+                }
+
+                std::pop_heap(_queue.begin(), _queue.end());
+                next = std::move(_queue.back());
+                _queue.pop_back();
+                have_next = true;
+            }
+
+            else if (!_queue.empty() && !_done)
             {
                 // Find the highest priority item in the queue.
                 // Note: We could use std::partial_sort or std::nth_element,
@@ -614,13 +1137,29 @@ job_scheduler::run()
 
             auto t0 = std::chrono::steady_clock::now();
 
-            bool job_executed = next._delegate();
+            if (_adaptMax > 0u)
+            {
+                _waits++;
+                _waitMicros += std::chrono::duration_cast<std::chrono::microseconds>(t0 - next._queued).count();
+            }
+
+            auto outerQueueWait = t_queueWait;
+            auto outerQueueWaitTaken = t_queueWaitTaken;
+            t_queueWait = t0 - next._queued;
+            t_queueWaitTaken = false;
+
+            // skip jobs that were canceled after we popped them
+            bool job_executed = !next.canceled() && next._delegate();
+
+            t_queueWait = outerQueueWait;
+            t_queueWaitTaken = outerQueueWaitTaken;
 
             auto duration = std::chrono::steady_clock::now() - t0;
 
             if (job_executed)
             {
                 jobsLeftToRun--;
+                _completed++;
             }
             else
             {
@@ -635,6 +1174,15 @@ job_scheduler::run()
             }
 
             _metrics->running--;
+
+            if (_adaptMax > 0u)
+            {
+                std::unique_lock lock(_adaptMutex, std::try_to_lock);
+                if (lock.owns_lock())
+                {
+                    adapt();
+                }
+            }
         }
 
         // See if we no longer need this thread because the
@@ -644,6 +1192,7 @@ job_scheduler::run()
         if (_targetConcurrency < _metrics->concurrency)
         {
             _metrics->concurrency--;
+            _exited.push_back(std::this_thread::get_id());
             break;
         }
     }
@@ -652,18 +1201,44 @@ job_scheduler::run()
 void
 job_scheduler::startThreads()
 {
+    std::scoped_lock lock(_quitMutex);
+
     _done = false;
 
     //Log::info() << LC << "Scheduler \"" << _name << "\" concurrency=" << _targetConcurrency << std::endl;
 
+    resizeThreads();
+}
+
+void
+job_scheduler::resizeThreads()
+{
+    // Join any threads that quit when the concurrency went down.
+    // They have already left run(), so this won't block for long.
+    for (auto& id : _exited)
+    {
+        auto iter = std::find_if(_threads.begin(), _threads.end(),
+            [&id](const std::thread& thread) { return thread.get_id() == id; });
+
+        if (iter != _threads.end())
+        {
+            iter->join();
+            _threads.erase(iter);
+        }
+    }
+    _exited.clear();
+
     // Not enough? Start up more
     while(_metrics->concurrency < _targetConcurrency)
     {
         _metrics->concurrency++;
 
-        _threads.push_back(std::thread([this]
+        unsigned index = _threads.size();
+        _threads.push_back(std::thread([this, index]
             {
                 util::setThreadName(_name.c_str());
+                t_scheduler = this;
+                t_worker = index;
                 run();
             }
         ));
@@ -672,7 +1247,10 @@ job_scheduler::startThreads()
 
 void job_scheduler::stopThreads()
 {
-    _done = true;
+    {
+        std::scoped_lock lock(_quitMutex);
+        _done = true;
+    }
 
     // Clear out the queue
     {
@@ -689,20 +1267,39 @@ void job_scheduler::stopThreads()
         }
         _queue.clear();
 
+        for (auto& lane : _lanes)
+        {
+            std::scoped_lock lane_lock(lane->_mutex);
+            for (auto& queuedjob : lane->_jobs)
+            {
+                if (queuedjob._groupsema != nullptr)
+                {
+                    queuedjob._groupsema->reset();
+                }
+            }
+            _stealable -= lane->_jobs.size();
+            lane->_jobs.clear();
+        }
+
         // wake up all threads so they can exit
         _block.notify_all();
     }
 
     // wait for them to exit
-    for (unsigned i = 0; i < _threads.size(); ++i)
+    std::vector<std::thread> threads;
     {
-        if (_threads[i].joinable())
+        std::scoped_lock lock(_quitMutex);
+        threads.swap(_threads);
+        _exited.clear();
+    }
+
+    for (auto& thread : threads)
+    {
+        if (thread.joinable())
         {
-            _threads[i].join();
+            thread.join();
         }
     }
-
-    _threads.clear();
 }
 
 const std::vector<std::shared_ptr<job_metrics::scheduler_metrics>>&
@@ -774,3 +1371,133 @@ job_metrics::totalJobsCanceled() const
         count += _schedulers[i]->canceled;
     return count;
 }
+
+#undef LC
+#define LC "[parallel] "
+
+// when the caller doesn't pick a grain, aim for this many chunks per thread
+// so that uneven rows still balance out
+#define ROCKY_PARALLEL_CHUNKS_PER_THREAD 4u
+
+namespace
+{
+    struct ParallelRun
+    {
+        std::size_t begin = 0, end = 0, grain = 1, numChunks = 0;
+        const std::function<void(std::size_t, std::size_t, std::size_t)>* body = nullptr;
+        const Cancelable* cancelable = nullptr;
+        std::atomic<std::size_t> next = { 0 };
+        std::atomic<std::size_t> finished = { 0 };
+        std::atomic<bool> canceled = { false };
+        std::exception_ptr error; // first exception thrown by body; guarded by mutex
+        std::mutex mutex;
+        std::condition_variable done;
+
+        // Claims and runs chunks until there are none left. A thread only touches
+        // body and cancelable after claiming a chunk, and the caller doesn't return
+        // until every claimed chunk is finished, so those pointers stay valid.
+        void work()
+        {
+            for (;;)
+            {
+                std::size_t chunk = next.fetch_add(1);
+                if (chunk >= numChunks)
+                    return;
+
+                if (!canceled)
+                {
+                    if (cancelable && cancelable->canceled())
+                    {
+                        canceled = true;
+                    }
+                    else
+                    {
+                        std::size_t b = begin + chunk * grain;
+                        std::size_t e = std::min(b + grain, end);
+                        try
+                        {
+                            (*body)(chunk, b, e);
+                        }
+                        catch (...)
+                        {
+                            // skip the rest; the caller rethrows once all chunks are finished
+                            std::unique_lock<std::mutex> lock(mutex);
+                            if (!error)
+                                error = std::current_exception();
+                            canceled = true;
+                        }
+                    }
+                }
+
+                if (finished.fetch_add(1) + 1 == numChunks)
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+        }
+    };
+}
+
+std::size_t
+util::detail::parallel_run(
+    std::size_t begin, std::size_t end, std::size_t grain,
+    const std::function<void(std::size_t, std::size_t, std::size_t)>& body,
+    const Cancelable* cancelable)
+{
+    if (end <= begin)
+        return 0;
+
+    auto scheduler = job_scheduler::get(ROCKY_PARALLEL_SCHEDULER_NAME);
+    unsigned helpers = scheduler ? scheduler->getConcurrency() : 0u;
+
+    std::size_t count = end - begin;
+    if (grain == 0)
+        grain = std::max(count / ((std::size_t)(helpers + 1) * ROCKY_PARALLEL_CHUNKS_PER_THREAD), (std::size_t)1);
+
+    auto run = std::make_shared<ParallelRun>();
+    run->begin = begin;
+    run->end = end;
+    run->grain = grain;
+    run->numChunks = (count + grain - 1) / grain;
+    run->body = &body;
+    run->cancelable = cancelable;
+
+    // Recruit helpers. We hold their futures until we return; any helper that
+    // never got a thread is then abandoned and dropped from the queue.
+    std::vector<Future<bool>> recruits;
+    helpers = (unsigned)std::min((std::size_t)helpers, run->numChunks - 1);
+    if (helpers > 0)
+    {
+        job config;
+        config.name = "parallel";
+        config.scheduler = scheduler;
+
+        recruits.reserve(helpers);
+        for (unsigned i = 0; i < helpers; ++i)
+        {
+            recruits.emplace_back(job::dispatch([run](Cancelable&)
+                {
+                    run->work();
+                    return true;
+                },
+                config));
+        }
+    }
+
+    // The caller works too, so we never wait on a helper that hasn't started.
+    run->work();
+
+    if (run->finished < run->numChunks)
+    {
+        std::unique_lock<std::mutex> lock(run->mutex);
+        run->done.wait(lock, [&]() { return run->finished == run->numChunks; });
+    }
+
+    if (run->error)
+    {
+        std::rethrow_exception(run->error);
+    }
+
+    return run->canceled ? 0 : run->numChunks;
+}
@@ -10,6 +10,7 @@
 #include <functional>
 #include <condition_variable>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
@@ -17,6 +18,7 @@
 #include <type_traits>
 #include <mutex>
 #include <chrono>
+#include <cstdint>
 
 // to include the file and line as the mutex name
 #define ROCKY_MUTEX_NAME __FILE__ ":" ROCKY_STRINGIFY(__LINE__)
@@ -77,8 +79,8 @@ namespace ROCKY_NAMESPACE { namespace util
 
         //! Block until the event is set or the timout expires.
         //! Return true if the event has set, otherwise false.
-        template<typename T>
-        inline bool wait(std::chrono::duration<T> timeout) {
+        template<typename Rep, typename Period>
+        inline bool wait(std::chrono::duration<Rep, Period> timeout) {
             if (!_set) {
                 std::unique_lock<std::mutex> lock(_m);
                 if (!_set)
@@ -112,9 +114,11 @@ namespace ROCKY_NAMESPACE { namespace util
     protected:
         std::mutex _m; // do not use Mutex, we never want tracking
         std::condition_variable_any _cond;
-        bool _set;
+        std::atomic<bool> _set;
     };
 
+    struct job;
+
     /**
      * Future holds the future result of an asynchronous operation.
      *
@@ -129,6 +133,10 @@ namespace ROCKY_NAMESPACE { namespace util
      *   same internal shared data) exist, the Future is considered valid. Once
      *   that count goes to one, the Future is either available (the value is ready)
      *   or empty (i.e., canceled or abandoned).
+     *
+     *   Instead of polling, Consumer can call then() to schedule the next stage
+     *   of work once the result is available, or combine several Futures with
+     *   when_all() or when_any(). No thread blocks while waiting.
      */
     template<typename T>
     class Future : public Cancelable
@@ -141,8 +149,39 @@ namespace ROCKY_NAMESPACE { namespace util
         {
             T _obj;
             mutable Event _ev;
+
+            // functions to call with the result when the promise is resolved
+            std::mutex _continuationsMutex;
+            std::vector<std::function<void(const T&)>> _continuations;
+
+            // continuations only: true until the next stage is underway, and the
+            // upstream futures whose results we are waiting on. Set once before
+            // the future is returned, so they need no locking.
+            std::atomic<bool> _pending = { false };
+            std::vector<std::shared_ptr<Cancelable>> _sources;
+            bool _needsAllSources = true;
+
+            // continuations only: whether the upstream futures were abandoned,
+            // meaning the promise will never be resolved
+            bool abandoned() const {
+                unsigned count = 0;
+                for (auto& source : _sources)
+                    if (source->canceled())
+                        ++count;
+                return _needsAllSources ? count > 0 : count == _sources.size();
+            }
         };
 
+        Future(std::shared_ptr<Shared> shared) : _shared(shared) { }
+
+        template<typename U> friend class Future;
+
+        template<typename U>
+        friend Future<std::vector<U>> when_all(const std::vector<Future<U>>&);
+
+        template<typename U>
+        friend Future<std::size_t> when_any(const std::vector<Future<U>>&);
+
     public:
         //! Blank CTOR
         Future() {
@@ -153,7 +192,11 @@ namespace ROCKY_NAMESPACE { namespace util
 
         //! True is this Future is unused and not connected to any other Future
         bool empty() const {
-            return !available() && _shared.use_count() == 1;
+            if (available())
+                return false;
+            if (_shared->_pending)
+                return _shared->abandoned();
+            return _shared.use_count() == 1;
         }
 
         //! True if the promise was resolved and a result if available.
@@ -199,7 +242,7 @@ namespace ROCKY_NAMESPACE { namespace util
         T join() const {
             while (
                 !empty() &&
-                !_shared->ev.wait(std::chrono::milliseconds(1)));
+                !_shared->_ev.wait(std::chrono::milliseconds(1)));
             return value();
         }
 
@@ -226,20 +269,36 @@ namespace ROCKY_NAMESPACE { namespace util
         //! Resolve (fulfill) the promise with the provided result value.
         void resolve(const T& value) {
             _shared->_obj = value;
-            _shared->_ev.set();
+            fulfill();
         }
 
         //! Resolve (fulfill) the promise with an rvalue
         void resolve(T&& value) {
             _shared->_obj = std::move(value);
-            _shared->_ev.set();
+            fulfill();
         }
 
         //! Resolve (fulfill) the promise with a default result
         void resolve() {
-            _shared->_ev.set();
+            fulfill();
         }
 
+        //! Schedule a job to run once this future's result is available,
+        //! without blocking any thread in the meantime.
+        //! If the result is already available, the job is dispatched immediately.
+        //! The returned future keeps this one alive; abandon it and this one
+        //! is abandoned too (unless someone else holds it). If this future is
+        //! abandoned, so is the returned one.
+        //! @param task Function to run in a thread. Prototype is U(const T&, Cancelable&)
+        //! @param config Job settings (name, priority, scheduler, group) for the next stage
+        //! @return Future result of the next stage
+        template<typename FUNC, typename U = typename std::result_of<FUNC(const T&, Cancelable&)>::type>
+        Future<U> then(FUNC task, const job& config) const;
+
+        //! Same as above but without the job parameter.
+        template<typename FUNC, typename U = typename std::result_of<FUNC(const T&, Cancelable&)>::type>
+        Future<U> then(FUNC task) const;
+
         //! The number of objects, including this one, that
         //! reference the shared container. If this method
         //! returns 1, that means this is the only object with
@@ -250,6 +309,42 @@ namespace ROCKY_NAMESPACE { namespace util
 
     private:
         std::shared_ptr<Shared> _shared;
+
+        // signal waiters and run continuations
+        void fulfill() {
+            std::vector<std::function<void(const T&)>> continuations;
+            {
+                std::scoped_lock lock(_shared->_continuationsMutex);
+                _shared->_ev.set();
+                continuations.swap(_shared->_continuations);
+            }
+            for (auto& continuation : continuations)
+                continuation(_shared->_obj);
+        }
+
+        // call "func" with the result once it's available (immediately if it
+        // already is) in whatever thread resolves the promise. Keep it short!
+        void onResolve(std::function<void(const T&)> func) const {
+            {
+                std::scoped_lock lock(_shared->_continuationsMutex);
+                if (!_shared->_ev.isSet()) {
+                    _shared->_continuations.emplace_back(std::move(func));
+                    return;
+                }
+            }
+            func(_shared->_obj);
+        }
+
+        // make a future to represent the result of work that will start
+        // once the "sources" resolve
+        template<typename U>
+        static Future<U> continuation(std::vector<std::shared_ptr<Cancelable>>&& sources, bool needsAll) {
+            Future<U> result;
+            result._shared->_sources = std::move(sources);
+            result._shared->_needsAllSources = needsAll;
+            result._shared->_pending = true;
+            return result;
+        }
     };
 
     /**
@@ -320,6 +415,105 @@ namespace ROCKY_NAMESPACE { namespace util
         bool _active;
     };
 
+    /**
+     * Single-flight request coalescing.
+     *
+     * get(key, func) runs func() and returns its result. If another thread is
+     * already running func for the same key, the caller waits for that result
+     * and shares it instead of doing the same work again. Unlike a cache, a
+     * result is only shared with callers that arrive while it's in flight.
+     *
+     * Usage:
+     *   util::Coalescer<TileKey, Result<GeoImage>> inflight;
+     *   auto result = inflight.get(key, [&]() { return createImage(key, io); }, &io);
+     */
+    template<typename K, typename V>
+    class Coalescer
+    {
+    public:
+        //! Number of calls that shared another caller's result
+        std::atomic<unsigned> coalesced = { 0u };
+
+        //! Run func() for key, or join a call already in flight for key.
+        //! If the running call's cancelable is canceled, its (likely partial) result
+        //! is not shared, and a waiting caller runs func() itself. A waiting caller
+        //! that is canceled stops waiting and runs func() as well, so it gets the
+        //! same canceled result it would have gotten on its own.
+        //! Callers get copies of one V, so if V holds pointers (e.g. to an Image),
+        //! they all point at the same data: treat it as read-only.
+        template<typename FUNC>
+        V get(const K& key, FUNC&& func, const Cancelable* cancelable = nullptr)
+        {
+            for (;;)
+            {
+                std::shared_ptr<Flight> flight;
+                bool leader = false;
+                {
+                    std::scoped_lock lock(_mutex);
+                    auto& entry = _flights[key];
+                    if (!entry)
+                    {
+                        entry = std::make_shared<Flight>();
+                        leader = true;
+                    }
+                    flight = entry;
+                }
+
+                if (leader)
+                {
+                    std::shared_ptr<V> result;
+                    try
+                    {
+                        result = std::make_shared<V>(func());
+                    }
+                    catch (...)
+                    {
+                        land(key, flight, nullptr);
+                        throw;
+                    }
+
+                    bool canceled = cancelable && cancelable->canceled();
+                    land(key, flight, canceled ? nullptr : result);
+                    return *result;
+                }
+
+                while (!flight->done.wait(std::chrono::milliseconds(10)))
+                {
+                    if (cancelable && cancelable->canceled())
+                        return func();
+                }
+
+                if (flight->result)
+                {
+                    ++coalesced;
+                    return *flight->result;
+                }
+
+                // the leader had nothing to share; try again.
+            }
+        }
+
+    private:
+        struct Flight
+        {
+            Event done;
+            std::shared_ptr<V> result;
+        };
+
+        std::mutex _mutex;
+        std::unordered_map<K, std::shared_ptr<Flight>> _flights;
+
+        void land(const K& key, std::shared_ptr<Flight>& flight, std::shared_ptr<V> result)
+        {
+            {
+                std::scoped_lock lock(_mutex);
+                _flights.erase(key);
+            }
+            flight->result = result;
+            flight->done.set();
+        }
+    };
+
     //! Sets the name of the curent thread
     extern ROCKY_EXPORT void setThreadName(const std::string& name);
 
@@ -416,8 +610,17 @@ namespace ROCKY_NAMESPACE { namespace util
         //! or the operation is canceled.
         void join(Cancelable&);
 
+        //! Cancel every job in this group that has not started yet,
+        //! removing them from their schedulers' queues right away.
+        //! Jobs dispatched to the group after this are canceled too.
+        void cancel();
+
+        //! Whether cancel() was called
+        bool canceled() const;
+
     private:
         std::shared_ptr<Semaphore> _sema;
+        std::shared_ptr<std::atomic_bool> _canceled;
         friend class job_scheduler;
     };
 
@@ -461,6 +664,14 @@ namespace ROCKY_NAMESPACE { namespace util
         job_scheduler* scheduler = nullptr;
         job_group* group = nullptr;
 
+        //! How long the job running on the calling thread waited in its
+        //! scheduler's queue before it started; zero outside of a job.
+        static std::chrono::steady_clock::duration queueWait();
+
+        //! Like queueWait(), but only the first call within a job returns
+        //! the wait; later calls return zero. For counting it once per job.
+        static std::chrono::steady_clock::duration takeQueueWait();
+
         //! Run the job and return a future result.
         //! @param task Function to run in a thread. Prototype is T(Cancelable&)
         //! @param settings Optional configuration for the asynchronous function call
@@ -491,15 +702,24 @@ namespace ROCKY_NAMESPACE { namespace util
         template<typename FUNC, typename T = typename std::result_of<FUNC(Cancelable&)>::type>
         static inline Future<T> dispatch(FUNC task, Future<T> promise, const job& config)
         {
-            std::function<bool()> delegate = [task, promise]() mutable
+            // the delegate and the scheduler share one reference to the promise,
+            // so the scheduler can see when everyone else abandons it.
+            auto shared_promise = std::make_shared<Future<T>>(promise);
+
+            std::function<bool()> delegate = [task, shared_promise]() mutable
             {
-                bool good = !promise.canceled();
+                bool good = !shared_promise->canceled();
                 if (good)
-                    promise.resolve(task(promise));
+                    shared_promise->resolve(task(*shared_promise));
                 return good;
             };
 
-            scheduler_dispatch(delegate, config);
+            std::function<bool()> canceled = [shared_promise]()
+            {
+                return shared_promise->canceled();
+            };
+
+            scheduler_dispatch(delegate, canceled, config);
 
             return promise;
         }
@@ -515,9 +735,135 @@ namespace ROCKY_NAMESPACE { namespace util
         }
 
     private:
-        static void scheduler_dispatch(std::function<bool()> del, const job& config);
+        static void scheduler_dispatch(std::function<bool()> del, std::function<bool()> canceled, const job& config);
     };
 
+    template<typename T>
+    template<typename FUNC, typename U>
+    Future<U> Future<T>::then(FUNC task, const job& config) const
+    {
+        auto result = continuation<U>({ std::make_shared<Future<T>>(*this) }, true);
+
+        // Hold the next stage weakly, so abandoning it cancels the chain
+        std::weak_ptr<typename Future<U>::Shared> next = result._shared;
+
+        onResolve([task, config, next](const T& value)
+            {
+                auto shared = next.lock();
+                if (shared)
+                {
+                    Future<U> promise(shared);
+                    shared->_pending = false;
+                    job::dispatch([task, value](Cancelable& c) { return task(value, c); }, promise, config);
+                }
+            });
+
+        return result;
+    }
+
+    template<typename T>
+    template<typename FUNC, typename U>
+    Future<U> Future<T>::then(FUNC task) const
+    {
+        job config;
+        return then(task, config);
+    }
+
+    /**
+     * Returns a future that resolves to all the results of "futures", in order,
+     * once every one of them is available. No thread waits in the meantime.
+     * Chain the next stage with then(). The returned future is abandoned if any
+     * of the inputs is abandoned.
+     */
+    template<typename T>
+    Future<std::vector<T>> when_all(const std::vector<Future<T>>& futures)
+    {
+        std::vector<std::shared_ptr<Cancelable>> sources;
+        for (auto& future : futures)
+            sources.emplace_back(std::make_shared<Future<T>>(future));
+
+        auto result = Future<T>::template continuation<std::vector<T>>(std::move(sources), true);
+
+        if (futures.empty())
+        {
+            result._shared->_pending = false;
+            result.resolve();
+            return result;
+        }
+
+        struct State {
+            std::mutex mutex;
+            std::vector<T> values;
+            std::size_t remaining;
+        };
+        auto state = std::make_shared<State>();
+        state->values.resize(futures.size());
+        state->remaining = futures.size();
+
+        std::weak_ptr<typename Future<std::vector<T>>::Shared> next = result._shared;
+
+        for (std::size_t i = 0; i < futures.size(); ++i)
+        {
+            futures[i].onResolve([state, next, i](const T& value)
+                {
+                    bool last;
+                    {
+                        std::scoped_lock lock(state->mutex);
+                        state->values[i] = value;
+                        last = (--state->remaining == 0);
+                    }
+                    auto shared = last ? next.lock() : nullptr;
+                    if (shared)
+                    {
+                        Future<std::vector<T>> promise(shared);
+                        shared->_pending = false;
+                        promise.resolve(std::move(state->values));
+                    }
+                });
+        }
+
+        return result;
+    }
+
+    /**
+     * Returns a future that resolves to the index of the first of "futures"
+     * to become available. No thread waits in the meantime. The other inputs
+     * stay alive until the returned future goes away. The returned future is
+     * abandoned if all of the inputs are abandoned.
+     */
+    template<typename T>
+    Future<std::size_t> when_any(const std::vector<Future<T>>& futures)
+    {
+        std::vector<std::shared_ptr<Cancelable>> sources;
+        for (auto& future : futures)
+            sources.emplace_back(std::make_shared<Future<T>>(future));
+
+        auto result = Future<T>::template continuation<std::size_t>(std::move(sources), false);
+
+        auto done = std::make_shared<std::atomic<bool>>(false);
+
+        std::weak_ptr<typename Future<std::size_t>::Shared> next = result._shared;
+
+        for (std::size_t i = 0; i < futures.size(); ++i)
+        {
+            futures[i].onResolve([done, next, i](const T&)
+                {
+                    if (done->exchange(true) == false)
+                    {
+                        auto shared = next.lock();
+                        if (shared)
+                        {
+                            Future<std::size_t> promise(shared);
+                            shared->_pending = false;
+                            promise.resolve(i);
+                        }
+                    }
+                });
+        }
+
+        return result;
+    }
+
     class ROCKY_EXPORT job_metrics
     {
     public:
@@ -570,10 +916,32 @@ namespace ROCKY_NAMESPACE { namespace util
     class ROCKY_EXPORT job_scheduler
     {
     public:
+        //! Strategy a scheduler uses to pick the next job to run
+        enum class queue_mode
+        {
+            //! Evaluate the priority of every queued job on each dequeue.
+            //! Always runs the current best job; fastest for short queues.
+            scan,
+
+            //! Keep queued jobs in a binary heap ordered by cached priorities,
+            //! and re-evaluate all priorities at a fixed interval (see
+            //! setRescoreInterval). Dequeue is O(log n); use for deep queues.
+            heap,
+
+            //! Give each worker thread its own heap-ordered queue ("lane").
+            //! Jobs dispatched from a worker go to that worker's lane; others
+            //! are spread across lanes. Idle workers steal the best job from
+            //! other lanes. Priority order is per-lane, so it is approximate
+            //! across the scheduler, but there is no single queue lock for
+            //! all workers to contend on. Use for many small jobs on many cores.
+            stealing
+        };
+
         //! Construct a new scheduler
         job_scheduler(
             const std::string& name = "",
-            unsigned concurrency = 2u);
+            unsigned concurrency = 2u,
+            queue_mode mode = queue_mode::scan);
 
         //! Destroy
         ~job_scheduler();
@@ -584,14 +952,42 @@ namespace ROCKY_NAMESPACE { namespace util
         //! Get the target concurrency (thread count) 
         unsigned getConcurrency() const;
 
+        //! Set the strategy used to pick the next job from the queue
+        void setQueueMode(queue_mode value);
+
+        //! Strategy used to pick the next job from the queue
+        queue_mode getQueueMode() const;
+
+        //! How often a queue_mode::heap or queue_mode::stealing scheduler
+        //! re-evaluates the priorities of its queued jobs
+        void setRescoreInterval(std::chrono::milliseconds value);
+
+        //! Let the scheduler tune its own concurrency at runtime, between
+        //! "minimum" and "maximum" threads. Every "interval" it measures job
+        //! throughput and queue latency and moves the concurrency one step
+        //! in whichever direction improves throughput (hill-climbing).
+        //! Pass a maximum of zero to turn it off (the default).
+        void setAdaptiveConcurrency(
+            unsigned minimum,
+            unsigned maximum,
+            std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+
         //! Discard all queued jobs
         void cancelAll();
 
+        //! Discard queued jobs that were canceled (their futures abandoned,
+        //! or their group canceled) without waiting for a worker to reach them.
+        //! Canceled jobs are also dropped whenever a worker re-evaluates
+        //! priorities; call this after abandoning a lot of futures at once.
+        //! @return Number of jobs removed
+        unsigned sweep();
+
         //! Schedule an asynchronous task on this scheduler
         //! Use job::dispatch to run jobs (usually no need to call this directly)
         //! @param job Job details
         //! @param delegate Function to execute
-        void dispatch(const job& config, std::function<bool()>& delegate);
+        //! @param canceled Function returning true if the job no longer needs to run
+        void dispatch(const job& config, std::function<bool()>& delegate, std::function<bool()> canceled = nullptr);
 
     public: // statics
 
@@ -601,6 +997,15 @@ namespace ROCKY_NAMESPACE { namespace util
         //! Sets the concurrency of a named scheduler
         static void setConcurrency(const std::string& name, unsigned value);
 
+        //! Sets the queue mode of a named scheduler
+        static void setQueueMode(const std::string& name, queue_mode value);
+
+        //! Turns on adaptive concurrency for a named scheduler
+        static void setAdaptiveConcurrency(const std::string& name, unsigned minimum, unsigned maximum);
+
+        //! Calls sweep() on every scheduler
+        static void sweepAll();
+
         static void shutdownAll();
 
     private:
@@ -615,20 +1020,65 @@ namespace ROCKY_NAMESPACE { namespace util
         //! Join and destroy all threads in this scheduler
         void stopThreads();
 
+        //! Start new threads, or join exited ones, to match the target concurrency.
+        //! Call with _quitMutex locked.
+        void resizeThreads();
+
+        //! Take a throughput sample and adjust the target concurrency if it's time.
+        //! Call with _adaptMutex locked.
+        void adapt();
+
+        //! Re-evaluate all queued priorities and rebuild the heap.
+        //! Call with _queueMutex locked.
+        void rescore();
+
+        //! Move queued jobs between the shared queue and the worker lanes
+        //! so they match the current queue mode.
+        //! Call with _queueMutex locked.
+        void rebalance();
+
         struct QueuedJob {
             QueuedJob() { }
-            QueuedJob(const job& job, const std::function<bool()>& delegate, std::shared_ptr<Semaphore> sema) :
-                _job(job), _delegate(delegate), _groupsema(sema) { }
+            QueuedJob(const job& job, const std::function<bool()>& delegate, const std::function<bool()>& canceled,
+                std::shared_ptr<Semaphore> sema, std::shared_ptr<std::atomic_bool> groupcanceled) :
+                _job(job), _delegate(delegate), _canceled(canceled), _groupsema(sema), _groupcanceled(groupcanceled) { }
             job _job;
             std::function<bool()> _delegate;
+            std::function<bool()> _canceled;
+            std::chrono::steady_clock::time_point _queued; // when dispatched (for adaptive concurrency)
             std::shared_ptr<Semaphore> _groupsema;
+            std::shared_ptr<std::atomic_bool> _groupcanceled;
+            inline bool canceled() const {
+                return (_groupcanceled && *_groupcanceled) || (_canceled && _canceled());
+            }
+            float _priority = 0.0f; // cached result of _job.priority (heap and stealing modes)
+            inline float evaluate() const {
+                return _job.priority ? _job.priority() : 0.0f;
+            }
             bool operator < (const QueuedJob& rhs) const {
-                float lp = _job.priority ? _job.priority() : -FLT_MAX;
-                float rp = rhs._job.priority ? rhs._job.priority() : -FLT_MAX;
-                return lp < rp;
+                return _priority < rhs._priority;
             }
         };
 
+        // per-worker job queue used in stealing mode
+        struct Lane {
+            std::mutex _mutex;
+            std::vector<QueuedJob> _jobs; // heap
+            std::chrono::steady_clock::time_point _lastRescore;
+        };
+
+        //! Pop the best job from the calling worker's lane, or steal one
+        //! from another lane. Returns false if all lanes are empty.
+        bool steal(QueuedJob& next);
+
+        //! Create the worker lanes for stealing mode, if necessary.
+        //! Call with _queueMutex locked.
+        void createLanes();
+
+        //! Remove canceled jobs from "jobs" and return how many were removed.
+        //! Lock whatever protects "jobs" before calling.
+        unsigned removeCanceled(std::vector<QueuedJob>& jobs);
+
         // pool name
         std::string _name;
         // queued operations to run asynchronously
@@ -639,21 +1089,146 @@ namespace ROCKY_NAMESPACE { namespace util
         mutable std::mutex _quitMutex;
         // target number of concurrent threads in the pool
         std::atomic<unsigned> _targetConcurrency;
+        // how to pick the next job from the queue
+        std::atomic<queue_mode> _queueMode;
+        // heap mode: how often to re-evaluate priorities, and when we last did
+        std::atomic<std::chrono::steady_clock::rep> _rescoreInterval;
+        std::chrono::steady_clock::time_point _lastRescore;
+        // stealing mode: one lane per worker; created once and never resized
+        std::vector<std::unique_ptr<Lane>> _lanes;
+        // stealing mode: number of jobs in all lanes
+        std::atomic<unsigned> _stealable;
+        // number of workers waiting for work, in any mode
+        std::atomic<unsigned> _sleepers;
+        // stealing mode: next lane for jobs dispatched from non-worker threads
+        std::atomic<unsigned> _nextLane;
+        // adaptive concurrency: limits (a zero maximum means off) and sampling interval
+        std::atomic<unsigned> _adaptMin;
+        std::atomic<unsigned> _adaptMax;
+        std::atomic<std::chrono::steady_clock::rep> _adaptInterval;
+        // adaptive concurrency: measurements for the current sample
+        std::atomic<unsigned> _completed;
+        std::atomic<unsigned> _waits;
+        std::atomic<std::uint64_t> _waitMicros;
+        // adaptive concurrency: controller state
+        std::mutex _adaptMutex;
+        std::chrono::steady_clock::time_point _adaptSampleStart;
+        double _lastThroughput;
+        int _adaptDirection;
         // thread waiter block
         std::condition_variable_any _block;
         // set to true when threads should exit
-        bool _done;
+        std::atomic<bool> _done;
         // threads in the pool
         std::vector<std::thread> _threads;
+        // threads that exited because the concurrency went down, waiting to be joined
+        std::vector<std::thread::id> _exited;
         // pointer to the stats structure for this scheduler
         job_metrics::scheduler_metrics* _metrics = nullptr;
 
         static std::mutex _schedulers_mutex;
         static std::unordered_map<std::string, unsigned> _schedulersizes;
+        static std::unordered_map<std::string, queue_mode> _schedulermodes;
+        static std::unordered_map<std::string, std::pair<unsigned, unsigned>> _scheduleradaptive;
         static std::unordered_map<std::string, std::shared_ptr<job_scheduler>> _schedulers;
 
         friend struct job;
     };
 
+    namespace detail
+    {
+        //! Runs body(chunk_begin, chunk_end) over [begin, end) in chunks of "grain"
+        //! items, sharing the work between the calling thread and the parallel scheduler.
+        //! Returns the number of chunks, or zero if canceled before completion.
+        //! If body throws, the remaining chunks are skipped and the first exception
+        //! is rethrown on the calling thread once every started chunk is finished.
+        extern ROCKY_EXPORT std::size_t parallel_run(
+            std::size_t begin, std::size_t end, std::size_t grain,
+            const std::function<void(std::size_t, std::size_t, std::size_t)>& body,
+            const Cancelable* cancelable);
+    }
+
+    /**
+     * Calls func(i) for each i in [begin, end), spreading the range across
+     * the "rocky.parallel" scheduler.
+     *
+     * The calling thread works through the range as well, and only waits for chunks
+     * that a helper thread has already started; so it is safe to call from inside
+     * a job, even if every thread in the pool is busy.
+     *
+     * Example:
+     *   util::parallel_for(0u, image->height(), [&](unsigned row) {
+     *       for(unsigned col = 0; col < image->width(); ++col) ...
+     *   }, &io);
+     *
+     * @param begin First index
+     * @param end One past the last index
+     * @param func Function to call for each index
+     * @param cancelable Optional; remaining chunks are skipped once it's canceled
+     * @param grain Number of indices per chunk, or zero to pick automatically
+     * @return true if every index was processed, false if canceled
+     * @throws The first exception thrown by func, after the other threads are done with it
+     */
+    template<typename INDEX, typename FUNC>
+    inline bool parallel_for(INDEX begin, INDEX end, FUNC&& func, const Cancelable* cancelable = nullptr, std::size_t grain = 0)
+    {
+        if (end <= begin)
+            return true;
+
+        // run over offsets from begin, so negative indices work too
+        std::function<void(std::size_t, std::size_t, std::size_t)> body =
+            [&func, begin](std::size_t, std::size_t b, std::size_t e)
+            {
+                for (std::size_t i = b; i < e; ++i)
+                    func((INDEX)((std::size_t)begin + i));
+            };
+
+        return detail::parallel_run(0, (std::size_t)end - (std::size_t)begin, grain, body, cancelable) > 0;
+    }
+
+    /**
+     * Reduces the range [begin, end) in parallel.
+     * Each chunk starts with a copy of "identity" and calls func(i, partial) for each
+     * of its indices; the partial results are then merged in index order with
+     * combine(a, b), so the result does not depend on thread timing.
+     * Like parallel_for, it is safe to call from inside a job.
+     *
+     * Example:
+     *   double sum = util::parallel_reduce(0u, count, 0.0,
+     *       [&](unsigned i, double& partial) { partial += values[i]; },
+     *       [](double a, double b) { return a + b; });
+     *
+     * @return Combined result; if canceled, the result covers only the chunks that ran.
+     * @throws The first exception thrown by func or combine
+     */
+    template<typename INDEX, typename T, typename FUNC, typename COMBINE>
+    inline T parallel_reduce(INDEX begin, INDEX end, const T& identity, FUNC&& func, COMBINE&& combine, const Cancelable* cancelable = nullptr, std::size_t grain = 0)
+    {
+        if (end <= begin)
+            return identity;
+
+        // one partial result per chunk, ordered by chunk index
+        std::map<std::size_t, T> partials;
+        std::mutex partials_mutex;
+
+        std::function<void(std::size_t, std::size_t, std::size_t)> body =
+            [&](std::size_t chunk, std::size_t b, std::size_t e)
+            {
+                T partial = identity;
+                for (std::size_t i = b; i < e; ++i)
+                    func((INDEX)((std::size_t)begin + i), partial);
+
+                std::scoped_lock L(partials_mutex);
+                partials.emplace(chunk, std::move(partial));
+            };
+
+        detail::parallel_run(0, (std::size_t)end - (std::size_t)begin, grain, body, cancelable);
+
+        T result = identity;
+        for (auto& partial : partials)
+            result = combine(result, partial.second);
+        return result;
+    }
+
 } } // namepsace rocky::util
 
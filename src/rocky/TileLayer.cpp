@@ -5,9 +5,12 @@
  */
 #include "TileLayer.h"
 #include "TileKey.h"
+#include "Image.h"
+#include "IOTrace.h"
 #include "Map.h"
 #include "rtree.h"
 #include "json.h"
+#include <sstream>
 
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::util;
@@ -17,6 +20,34 @@ using namespace ROCKY_NAMESPACE::util;
 namespace
 {
     using DataExtentsIndex = RTree<DataExtent, double, 2>;
+
+    // Cache records hold an image in the raw image format, deflated since
+    // tiles often have large uniform areas. No image codec required.
+    bool encodeImageRecord(const Image& image, std::string& record)
+    {
+        std::ostringstream raw;
+        if (writeRawImage(image, raw).failed())
+            return false;
+
+        std::ostringstream out;
+        if (!util::ZLibCompressor().compress(raw.str(), out))
+            return false;
+
+        record = out.str();
+        return true;
+    }
+
+    shared_ptr<Image> decodeImageRecord(const std::string& record)
+    {
+        std::istringstream in(record);
+        std::string raw;
+        if (!util::ZLibCompressor().decompress(in, raw))
+            return nullptr;
+
+        std::istringstream rawIn(raw);
+        auto r = readRawImage(rawIn);
+        return r.status.ok() ? r.value : nullptr;
+    }
 }
 
 TileLayer::TileLayer() :
@@ -110,7 +141,7 @@ TileLayer::openImplementation(const IOOptions& io)
     auto result = super::openImplementation(io);
     if (result.ok())
     {
-        //todo
+        establishCacheSettings();
     }
     return result;
 }
@@ -188,7 +219,110 @@ TileLayer::openForWriting()
 void
 TileLayer::establishCacheSettings()
 {
-    //nop
+    // start with the layer's policy and let the hints override it.
+    CachePolicy policy = cachePolicy();
+    policy.mergeAndOverride(hints().cachePolicy);
+
+    // dynamic data changes under us, so caching it makes no sense.
+    if (isDynamic())
+        policy.usage = CachePolicy::Usage::NO_CACHE;
+
+    _runtimeCachePolicy = policy;
+
+    // Unless the user gave us a cache ID, derive one from the settings that
+    // affect the data, so that changing them starts a fresh bin.
+    if (_cacheid.has_value() && !_cacheid.value().empty())
+    {
+        _runtimeCacheId = _cacheid.value();
+    }
+    else
+    {
+        auto j = parse_json(to_json());
+        for (auto& ignore : { "name", "open", "attribution", "l2_cache_size", "cache_policy" })
+            j.erase(ignore);
+        _runtimeCacheId = util::hashToString(j.dump());
+    }
+}
+
+bool
+TileLayer::isCacheOnly() const
+{
+    return _runtimeCachePolicy.has_value() && _runtimeCachePolicy.value().isCacheOnly();
+}
+
+Result<shared_ptr<Image>>
+TileLayer::readTileFromCache(const TileKey& key, const IOOptions& io) const
+{
+    if (!_runtimeCachePolicy.has_value() || !_runtimeCachePolicy.value().isCacheReadable())
+        return Status(Status::ResourceUnavailable);
+
+    auto cache = io.services().cache ? io.services().cache() : nullptr;
+    if (!cache)
+        return Status(Status::ResourceUnavailable);
+
+    auto* trace = IOTracer::current();
+
+    auto r = cache->read(_runtimeCacheId, key.profile().getHorizSignature() + '/' + key.str());
+    if (r.status.failed())
+    {
+        if (trace) trace->cacheMisses++;
+        return r.status;
+    }
+
+    // in cache-only mode, stale data is better than none
+    if (_runtimeCachePolicy.value().isExpired(r.value.lastModified) && !isCacheOnly())
+    {
+        if (trace) trace->cacheMisses++;
+        return Status(Status::ResourceUnavailable, "Expired");
+    }
+
+    auto decoding = IOTracer::Clock::now();
+    auto image = decodeImageRecord(r.value.data);
+    if (!image)
+    {
+        if (trace) trace->cacheMisses++;
+        return Status(Status::GeneralError, "Corrupt cache record");
+    }
+
+    if (trace)
+    {
+        trace->cacheHits++;
+        trace->time[IOTracer::DECODE] += IOTracer::Clock::now() - decoding;
+    }
+
+    return image;
+}
+
+bool
+TileLayer::isTileInCache(const TileKey& key, const IOOptions& io) const
+{
+    if (!_runtimeCachePolicy.has_value() || !_runtimeCachePolicy.value().isCacheReadable())
+        return false;
+
+    auto cache = io.services().cache ? io.services().cache() : nullptr;
+    if (!cache)
+        return false;
+
+    // only the timestamp; the load stage reads the record itself
+    auto r = cache->stat(_runtimeCacheId, key.profile().getHorizSignature() + '/' + key.str());
+    return r.status.ok() && (!_runtimeCachePolicy.value().isExpired(r.value) || isCacheOnly());
+}
+
+Status
+TileLayer::writeTileToCache(const TileKey& key, shared_ptr<Image> image, const IOOptions& io) const
+{
+    if (!image || !_runtimeCachePolicy.has_value() || !_runtimeCachePolicy.value().isCacheWriteable())
+        return StatusOK;
+
+    auto cache = io.services().cache ? io.services().cache() : nullptr;
+    if (!cache)
+        return StatusOK;
+
+    std::string record;
+    if (!encodeImageRecord(*image, record))
+        return Status(Status::GeneralError, "Failed to encode cache record");
+
+    return cache->write(_runtimeCacheId, key.profile().getHorizSignature() + '/' + key.str(), record);
 }
 
 const Profile&
@@ -671,6 +805,33 @@ TileLayer::intersects(const TileKey& key) const
 #endif
 }
 
+Status
+TileLayer::prefetch(const TileKey& key, const IOOptions& io) const
+{
+    if (!isOpen())
+    {
+        return status();
+    }
+
+    // keys in other profiles need a mosaic or reprojection,
+    // which the create call will have to fetch on its own.
+    if (key.profile() != profile() ||
+        !isKeyInLegalRange(key) ||
+        !mayHaveData(key))
+    {
+        return StatusOK;
+    }
+
+    // the create call will read these from the cache, and cache-only
+    // layers never go to the network
+    if (isCacheOnly() || isTileInCache(key, io))
+    {
+        return StatusOK;
+    }
+
+    return prefetchImplementation(key, io);
+}
+
 bool
 TileLayer::mayHaveData(const TileKey& key) const
 {
@@ -141,6 +141,18 @@ namespace ROCKY_NAMESPACE
         //! Adds a DataExent to this layer.
         void addDataExtent(const DataExtent& dataExtent);
 
+    public: // Data access
+
+        //! Fetches the raw data for a tile key into the I/O caches without
+        //! decoding it, so that a subsequent call to create the tile's data
+        //! is CPU-bound. Does nothing for layers that don't support it or
+        //! for keys that are not in the layer's own profile.
+        //! @param key TileKey for which to fetch data
+        //! @param io I/O options and cancelation callback
+        Status prefetch(
+            const TileKey& key,
+            const IOOptions& io) const;
+
     public: // Layer
 
         //! Extent of this layer
@@ -159,6 +171,38 @@ namespace ROCKY_NAMESPACE
         //! Call this if you call dataExtents() and modify it.
         void dirtyDataExtents();
 
+        //! Subclass overrides this to fetch (but not decode) the data for a key.
+        //! The key will always be in the same profile as the layer.
+        virtual Status prefetchImplementation(
+            const TileKey& key,
+            const IOOptions& io) const
+        {
+            return StatusOK;
+        }
+
+        //! Reads the data for a key from the persistent cache service in the
+        //! IOOptions, if there is one, the layer's cache policy allows it,
+        //! and the record has not expired.
+        Result<shared_ptr<Image>> readTileFromCache(
+            const TileKey& key,
+            const IOOptions& io) const;
+
+        //! Whether readTileFromCache would find data for a key
+        //! (without decoding it)
+        bool isTileInCache(
+            const TileKey& key,
+            const IOOptions& io) const;
+
+        //! Writes the data for a key to the persistent cache service in the
+        //! IOOptions, if there is one and the layer's cache policy allows it.
+        Status writeTileToCache(
+            const TileKey& key,
+            shared_ptr<Image> image,
+            const IOOptions& io) const;
+
+        //! Whether the cache policy says to only ever read data from the cache
+        bool isCacheOnly() const;
+
     protected:
 
         // cache key for metadata
@@ -6,10 +6,15 @@
 #include "URI.h"
 #include "Utils.h"
 #include "Instance.h"
+#include "Threading.h"
+#include "IOTrace.h"
 #include <typeinfo>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <iomanip>
+#include <locale>
+#include <random>
 
 #ifdef HTTPLIB_FOUND
 #ifdef OPENSSL_FOUND
@@ -40,6 +45,9 @@ namespace
 {
     static bool httpDebug = ::getenv("ROCKY_HTTP_DEBUG") != nullptr;
 
+    // reads currently in progress, by full URI
+    static util::Coalescer<std::string, IOResult<Content>> s_inflight;
+
     bool containsServerAddress(const std::string& input)
     {
         auto temp = util::trim(util::toLower(input));
@@ -81,9 +89,222 @@ namespace
     {
         int status;
         std::string data;
-        std::unordered_map<std::string, std::string> headers;
+        std::unordered_map<std::string, std::string> headers; // names in lower case
+
+        std::string header(const std::string& name) const
+        {
+            auto i = headers.find(name);
+            return i != headers.end() ? i->second : std::string();
+        }
     };
 
+    // Parses an HTTP date (RFC 1123 format, e.g. "Sun, 06 Nov 1994 08:49:37 GMT").
+    // Returns 0 if the input isn't a valid date.
+    TimeStamp parse_http_date(const std::string& input)
+    {
+        std::tm tm = {};
+        std::istringstream in(input);
+        in.imbue(std::locale::classic());
+        in >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S");
+        if (in.fail())
+            return 0;
+
+        double hours = (double)tm.tm_hour + (double)tm.tm_min / 60.0 + (double)tm.tm_sec / 3600.0;
+        return DateTime(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, hours).asTimeStamp();
+    }
+
+    // Works out when a response goes stale from its Cache-Control, Expires, Date
+    // and Age headers (RFC 9111). Returns 0 if the server gave no freshness
+    // information. Sets "store" to false if the response must not be cached.
+    TimeStamp http_expiration(const HTTPResponse& response, bool& store)
+    {
+        store = true;
+        TimeStamp now = DateTime().asTimeStamp();
+        TimeStamp age = std::max(0ll, std::atoll(response.header("age").c_str()));
+
+        auto cache_control = response.header("cache-control");
+        if (!cache_control.empty())
+        {
+            long long max_age = -1;
+
+            util::StringVector directives;
+            util::StringTokenizer tokenizer(",", "\"");
+            tokenizer.tokenize(util::toLower(cache_control), directives);
+
+            for (auto& directive : directives)
+            {
+                if (directive == "no-store")
+                    store = false;
+                else if (directive == "no-cache")
+                    max_age = 0;
+                else if (util::startsWith(directive, "max-age=") && max_age != 0)
+                    max_age = std::atoll(directive.c_str() + 8);
+            }
+
+            if (max_age >= 0)
+                return now + std::max(0ll, max_age - (long long)age);
+        }
+
+        auto expires = response.header("expires");
+        if (!expires.empty())
+        {
+            // an invalid Expires (like "0") means already expired
+            auto expires_time = parse_http_date(expires);
+            if (expires_time == 0)
+                return now;
+
+            // measure the lifetime on the server's clock in case ours differs
+            auto date = parse_http_date(response.header("date"));
+            auto lifetime = (long long)expires_time - (long long)(date != 0 ? date : now);
+            return now + std::max(0ll, lifetime - (long long)age);
+        }
+
+        return 0;
+    }
+
+    // Files at least this big are memory-mapped rather than read
+    constexpr std::uintmax_t min_mapped_file_size = 64 * 1024;
+
+    // Loads a local file's bytes, mapping large files so they aren't copied
+    Result<ByteBuffer> read_local_file(const std::string& filename)
+    {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(filename, ec);
+        if (ec)
+        {
+            return Result<ByteBuffer>(Status::ResourceUnavailable, ec.message());
+        }
+
+        if (size >= min_mapped_file_size)
+        {
+            return ByteBuffer::map(filename);
+        }
+
+        std::string data(size, '\0');
+        std::ifstream in(filename, std::ios_base::in | std::ios_base::binary);
+        if (!in.read(data.data(), size))
+        {
+            return Result<ByteBuffer>(Status::GeneralError, "Cannot read " + filename);
+        }
+
+        return ByteBuffer(std::move(data));
+    }
+
+#ifdef HTTPLIB_FOUND
+    // Longest we'll wait before retrying a request, whatever the server says
+    const std::chrono::milliseconds max_retry_delay = std::chrono::minutes(2);
+
+    // Responses meaning "try again later"
+    inline bool is_transient(int status)
+    {
+        return status == 429 || status == 502 || status == 503 || status == 504;
+    }
+
+    // Exponential backoff with jitter before retry number "attempt" (1-based),
+    // so many clients that failed together don't all retry together
+    std::chrono::milliseconds backoff(unsigned attempt)
+    {
+        static thread_local std::minstd_rand prng(std::random_device{}());
+        long long ceiling = std::min(500ll << std::min(attempt - 1, 8u), (long long)max_retry_delay.count());
+        std::uniform_int_distribution<long long> jitter(ceiling / 2, ceiling);
+        return std::chrono::milliseconds(jitter(prng));
+    }
+
+    // Parses a Retry-After header, which is either a number of seconds or an HTTP date
+    std::chrono::milliseconds parse_retry_after(const std::string& value)
+    {
+        long long seconds;
+        if (!value.empty() && std::isdigit((unsigned char)value[0]))
+        {
+            seconds = std::atoll(value.c_str());
+        }
+        else
+        {
+            auto when = parse_http_date(value);
+            seconds = when > 0 ? (long long)(when - DateTime().asTimeStamp()) : 1;
+        }
+
+        return std::min(std::chrono::milliseconds(std::max(0ll, seconds) * 1000), max_retry_delay);
+    }
+
+    // Sleeps in short steps so cancelation cuts the wait short.
+    // Returns false if canceled.
+    bool sleep_unless_canceled(std::chrono::milliseconds duration, const IOOptions& io)
+    {
+        auto until = std::chrono::steady_clock::now() + duration;
+        while (!io.canceled())
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= until)
+                return true;
+            std::this_thread::sleep_for(std::min(std::chrono::duration_cast<std::chrono::milliseconds>(until - now), std::chrono::milliseconds(100)));
+        }
+        return false;
+    }
+
+    // Content encodings we can decode, for the Accept-Encoding header
+    const std::string accepted_encodings = util::ZStdCompressor::available() ?
+        "gzip, deflate, zstd" :
+        "gzip, deflate";
+
+    // Largest body we'll decode; a small response can expand enormously
+    const std::size_t max_decoded_size = 256u * 1024u * 1024u;
+
+    // Removes the Content-Encoding from a response body, in place.
+    Status decode_body(HTTPResponse& response)
+    {
+        auto encoding = util::toLower(util::trim(response.header("content-encoding")));
+        if (encoding.empty() || encoding == "identity")
+        {
+            return StatusOK;
+        }
+
+        std::string decoded;
+        bool ok = false;
+
+        if (encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate")
+        {
+            // zlib detects gzip vs. zlib framing by itself
+            std::istringstream in(response.data);
+            ok = util::ZLibCompressor(max_decoded_size).decompress(in, decoded);
+
+            // some servers send "deflate" as raw deflate data, without the zlib header
+            if (!ok && encoding == "deflate")
+            {
+                std::istringstream raw(response.data);
+                decoded.clear();
+                ok = util::ZLibCompressor(max_decoded_size, true).decompress(raw, decoded);
+            }
+        }
+
+        else if (encoding == "zstd" && util::ZStdCompressor::available())
+        {
+            ok = util::ZStdCompressor({}, 3, max_decoded_size).decompress(response.data, decoded);
+        }
+
+        else
+        {
+            return Status(Status::GeneralError, "Unsupported content encoding \"" + encoding + "\"");
+        }
+
+        if (!ok)
+        {
+            return Status(Status::GeneralError, "Cannot decode " + encoding + " content");
+        }
+
+        response.data = std::move(decoded);
+        response.headers.erase("content-encoding");
+        response.headers.erase("content-length");
+        return StatusOK;
+    }
+#endif
+
+    // Whether a cached copy can be used without checking with the server
+    inline bool is_fresh(const Content& content)
+    {
+        return content.expires == 0 || DateTime().asTimeStamp() < content.expires;
+    }
+
     bool split_url(
         const std::string& url,
         std::string& proto_host_port,
@@ -119,7 +340,38 @@ namespace
         return true;
     }
 
-    IOResult<HTTPResponse> http_get(const HTTPRequest& request, unsigned max_attempts)
+#ifdef HTTPLIB_FOUND
+    // keep-alive client that lives in the IOOptions connection pool
+    struct HTTPConnection : public ConnectionPool::Connection
+    {
+        httplib::Client client;
+        IOTracer::Clock::time_point opened; // when the client last opened a socket
+
+        HTTPConnection(const std::string& proto_host_port) :
+            client(proto_host_port)
+        {
+            client.set_keep_alive(true);
+
+            // httplib connects lazily inside a request; this is called once the
+            // host name is resolved, right before the TCP and TLS handshakes
+            client.set_socket_options([this](httplib::socket_t) {
+                opened = IOTracer::Clock::now();
+            });
+
+            // follow redirects
+            client.set_follow_location(true);
+
+            // disable cert verification
+            client.enable_server_certificate_verification(false);
+
+            // we negotiate and decode compressed content ourselves
+            // so we can count the bytes on both sides
+            client.set_decompress(false);
+        }
+    };
+#endif
+
+    IOResult<HTTPResponse> http_get(const HTTPRequest& request, const IOOptions& io)
     {
 #ifndef HTTPLIB_FOUND
         return Status(Status::ServiceUnavailable);
@@ -130,6 +382,12 @@ namespace
             headers.insert(std::make_pair(h.name, h.value));
         }
 
+        // ask for compressed content unless the caller has other plans
+        if (headers.find("Accept-Encoding") == headers.end())
+        {
+            headers.insert(std::make_pair("Accept-Encoding", accepted_encodings));
+        }
+
         std::string proto_host_port;
         std::string path;
         std::string query_text;
@@ -144,55 +402,175 @@ namespace
 
         try
         {
-            httplib::Client client(proto_host_port);
+            auto& pool = *io.services().connectionPool;
+            auto& limiter = *io.services().rateLimiter;
+            auto* trace = IOTracer::current();
 
-            // follow redirects
-            client.set_follow_location(true);
+            unsigned max_attempts = std::max(1u, io.maxNetworkAttempts);
 
-            // disable cert verification
-            client.enable_server_certificate_verification(false);
+            for(unsigned attempt = 1; ; ++attempt)
+            {
+                auto waiting = IOTracer::Clock::now();
 
-            max_attempts = std::max(1u, max_attempts);
+                // wait our turn under the host's rate limit, or out a Retry-After pause
+                if (!limiter.acquire(proto_host_port, io.maxRequestsPerSecond, &io))
+                {
+                    return Status(Status::ResourceUnavailable, "Canceled");
+                }
+
+                // reuse a keep-alive connection to this server if we can,
+                // so we skip the TCP/TLS handshake on every tile.
+                IOTracer::Clock::duration connecting(0);
+                auto lease = pool.acquire(proto_host_port, [&](const std::string& key) {
+                        auto start = IOTracer::Clock::now();
+                        auto connection = std::make_unique<HTTPConnection>(key);
+                        connecting += IOTracer::Clock::now() - start;
+                        return connection;
+                    }, &io, io.maxRequestsPerHost);
+
+                if (!lease)
+                {
+                    return io.canceled() ?
+                        Status(Status::ResourceUnavailable, "Canceled") :
+                        Status(Status::ServiceUnavailable, "Cannot connect to " + proto_host_port);
+                }
+
+                auto* connection = static_cast<HTTPConnection*>(lease.get());
+                auto& client = connection->client;
 
-            for(;;)
-            {
                 util::timer timer;
 
-                auto r = client.Get(path, params, headers);
+                // receive the body ourselves so we can time the first byte
+                auto sent = IOTracer::Clock::now();
+                auto first_byte = sent;
+                std::string body;
+                auto r = client.Get(path, params, headers, [&](const char* data, std::size_t length)
+                    {
+                        if (body.empty())
+                            first_byte = IOTracer::Clock::now();
+                        body.append(data, length);
+                        return true;
+                    });
+
+                if (trace)
+                {
+                    auto received = IOTracer::Clock::now();
+                    if (body.empty())
+                        first_byte = received;
+
+                    // if this request (re)opened the socket, resolving the host
+                    // counts as connecting; the first byte is timed from there
+                    bool opened = connection->opened > sent;
+                    auto connected = opened ? connection->opened : sent;
+                    if (first_byte < connected)
+                        first_byte = connected;
+
+                    trace->host = proto_host_port;
+                    trace->requests++;
+                    trace->connects += opened ? 1 : 0;
+                    trace->bytes += body.size();
+                    trace->time[IOTracer::WAIT] += (sent - waiting) - connecting;
+                    trace->time[IOTracer::CONNECT] += connecting + (connected - sent);
+                    trace->time[IOTracer::FIRST_BYTE] += first_byte - connected;
+                    trace->time[IOTracer::TRANSFER] += received - first_byte;
+                }
 
                 if (httpDebug)
                 {
-                    Log::info() << LC << "(" << r->status << ") HTTP GET " << request.url << " (" << timer.seconds() << "s)" << std::endl;
+                    Log::info() << LC << "(" << (r ? std::to_string(r->status) : httplib::to_string(r.error())) << ") HTTP GET "
+                        << request.url << " (" << timer.seconds() << "s)" << std::endl;
                 }
 
+                bool retry = false;
+                std::chrono::milliseconds retry_delay(0);
+
                 if (r.error() != httplib::Error::Success)
                 {
+                    // the socket is in an unknown state; don't hand it to anyone else
+                    lease.discard();
+
                     // retry on a missing connection
-                    if (r.error() == httplib::Error::Connection && (--max_attempts > 0))
+                    if (r.error() != httplib::Error::Connection || attempt >= max_attempts)
                     {
-                        Log::info() << LC << httplib::to_string(r.error()) << " with " << proto_host_port << "; retrying.." << std::endl;
-                        std::this_thread::sleep_for(1s);
-                        continue;
+                        return Status(Status::ServiceUnavailable, httplib::to_string(r.error()));
                     }
 
-                    return Status(Status::ServiceUnavailable, httplib::to_string(r.error()));
+                    retry = true;
+                    retry_delay = backoff(attempt);
                 }
+                else if (is_transient(r->status))
+                {
+                    // server is overloaded or throttling us
+                    if (attempt >= max_attempts)
+                    {
+                        return Status(Status::ServiceUnavailable, httplib::detail::status_message(r->status));
+                    }
 
-                if (r->status == 404)
+                    retry = true;
+                    auto retry_after = r->get_header_value("Retry-After");
+                    if (!retry_after.empty())
+                    {
+                        // the server told us when to come back; hold back everyone else too
+                        retry_delay = parse_retry_after(retry_after);
+                        limiter.pause(proto_host_port, RateLimiter::Clock::now() + retry_delay);
+                    }
+                    else
+                    {
+                        retry_delay = backoff(attempt);
+                    }
+                }
+                else if (r->status == 404)
                 {
                     return Status(Status::ResourceUnavailable, httplib::detail::status_message(r->status));
                 }
-                else if (r->status != 200)
+                else if (r->status != 200 && r->status != 304) // 304 = Not Modified
                 {
                     return Status(Status::GeneralError, httplib::detail::status_message(r->status));
                 }
 
+                if (retry)
+                {
+                    Log::info() << LC << (r ? httplib::detail::status_message(r->status) : httplib::to_string(r.error()))
+                        << " from " << proto_host_port << "; retrying in " << retry_delay.count() << "ms.." << std::endl;
+
+                    // give the connection back while we wait
+                    lease.release();
+
+                    auto sleeping = IOTracer::Clock::now();
+                    bool canceled = !sleep_unless_canceled(retry_delay, io);
+
+                    if (trace)
+                        trace->time[IOTracer::WAIT] += IOTracer::Clock::now() - sleeping;
+
+                    if (canceled)
+                    {
+                        return Status(Status::ResourceUnavailable, "Canceled");
+                    }
+                    continue;
+                }
+
                 response.status = r->status;
 
                 for (auto& h : r->headers)
-                    response.headers[h.first] = h.second;
+                    response.headers[util::toLower(h.first)] = h.second;
+
+                response.data = std::move(body);
+
+                auto& stats = *io.services().networkStats;
+                stats.responses++;
+                stats.bytesTransferred += response.data.size();
+
+                auto decoding = IOTracer::Clock::now();
+                auto decoded = decode_body(response);
+                if (decoded.failed())
+                {
+                    return decoded;
+                }
+
+                if (trace)
+                    trace->time[IOTracer::DECODE] += IOTracer::Clock::now() - decoding;
 
-                response.data = std::move(r->body);
+                stats.bytesDecoded += response.data.size();
 
                 break;
             }
@@ -296,63 +674,128 @@ URI::URI(const std::string& location, const URIContext& context)
 IOResult<Content>
 URI::read(const IOOptions& io) const
 {
-    auto cached = io.services().contentCache->get(full());
-    if (cached.status.ok())
+    // A cached copy that's still fresh can be used as-is; a stale one
+    // is revalidated with the server below.
+    auto cached = io.services().contentCache->find(full());
+    const Content* stale = nullptr;
+    auto* trace = IOTracer::current();
+
+    if (cached && cached->status.ok())
     {
-        if (httpDebug)
+        if (is_fresh(cached->value))
         {
-            Log::info() << "Cache hit, ratio = "
-                << 100.0f * (float)io.services().contentCache->hits / (float)io.services().contentCache->gets
-                << "%" << std::endl;
+            if (trace)
+                trace->cacheHits++;
+
+            if (httpDebug)
+            {
+                auto stats = io.services().contentCache->stats();
+                Log::info() << "Cache hit, ratio = "
+                    << 100.0f * (float)stats.hits / (float)stats.gets << "%, "
+                    << stats.entries << " entries, " << stats.cost / 1024 << " KB, "
+                    << stats.evictions << " evictions" << std::endl;
+            }
+
+            return cached->value;
         }
 
-        return cached.value;
+        stale = &cached->value;
     }
 
-    Content content;
-    bool localFile = std::filesystem::exists(full());
-    if (!localFile)
-    {
-        HTTPRequest request{ full() };
-        auto r = http_get(request, io.maxNetworkAttempts);
-        if (r.status.failed())
+    if (trace)
+        trace->cacheMisses++;
+
+    // If another thread is already reading this URI, wait for its result
+    // instead of fetching the same thing twice.
+    return s_inflight.get(full(), [&]() -> IOResult<Content>
         {
-            return IOResult<Content>::propagate(r);
-        }
+            Content content;
+            bool localFile = std::filesystem::exists(full());
+            if (!localFile)
+            {
+                HTTPRequest request{ full() };
 
-        std::string contentType;
+                // ask the server to skip the download if our copy is still current
+                if (stale)
+                {
+                    if (!stale->etag.empty())
+                        request.headers.push_back({ "If-None-Match", stale->etag });
+                    if (!stale->lastModified.empty())
+                        request.headers.push_back({ "If-Modified-Since", stale->lastModified });
+                }
 
-        auto i = r.value.headers.find("Content-Type");
-        if (i != r.value.headers.end())
-            contentType = i->second;
-        else
-            contentType = inferContentTypeFromFileExtension(full());
+                auto r = http_get(request, io);
+                if (r.status.failed())
+                {
+                    // server unreachable; a stale copy beats nothing
+                    if (stale && r.status.code == Status::ServiceUnavailable)
+                        return *stale;
 
-        if (contentType.empty())
-            contentType = inferContentTypeFromData(r.value.data);
+                    return IOResult<Content>::propagate(r);
+                }
 
-        content = {
-            contentType,
-            r.value.data
-        };
-    }
-    else
-    {
-        auto contentType = inferContentTypeFromFileExtension(full());
+                bool store;
+                auto expires = http_expiration(r.value, store);
+
+                if (r.value.status == 304)
+                {
+                    if (!stale)
+                        return Status(Status::GeneralError, "Unexpected 304 Not Modified");
 
-        ROCKY_TODO("worry about text or binary open mode?");
+                    if (httpDebug)
+                        Log::info() << LC << "Revalidated " << full() << std::endl;
 
-        std::ifstream in(full().c_str(), std::ios_base::in);
-        std::stringstream buf;
-        buf << in.rdbuf() << std::flush;
-        content.data = buf.str();
-        content.contentType = contentType;
-        in.close();
-    }
+                    content = *stale;
+
+                    // with no freshness information the copy stays stale, so the
+                    // next request checks again (expires == 0 would mean "forever")
+                    content.expires = expires != 0 ? expires : DateTime().asTimeStamp();
+
+                    auto etag = r.value.header("etag");
+                    if (!etag.empty())
+                        content.etag = etag;
+                }
+                else
+                {
+                    std::string contentType = r.value.header("content-type");
+
+                    if (contentType.empty())
+                        contentType = inferContentTypeFromFileExtension(full());
+
+                    if (contentType.empty())
+                        contentType = inferContentTypeFromData(r.value.data);
+
+                    content = {
+                        contentType,
+                        std::move(r.value.data),
+                        r.value.header("etag"),
+                        r.value.header("last-modified"),
+                        expires
+                    };
+                }
+
+                if (!store)
+                {
+                    io.services().contentCache->remove(full());
+                    return content;
+                }
+            }
+            else
+            {
+                auto data = read_local_file(full());
+                if (data.status.failed())
+                {
+                    return data.status;
+                }
+
+                content.data = data.value;
+                content.contentType = inferContentTypeFromFileExtension(full());
+            }
 
-    io.services().contentCache->put(full(), Result<Content>(content));
+            io.services().contentCache->put(full(), Result<Content>(content));
 
-    return content;
+            return content;
+        }, &io);
 }
 
 bool
@@ -12,12 +12,21 @@
 #include <cstring>
 #include <filesystem>
 
+#ifdef ZSTD_FOUND
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
 #ifdef WIN32
 #include <Windows.h>
 #endif
 
 ROCKY_ABOUT(zlib, ZLIB_VERSION)
 
+#ifdef ZSTD_FOUND
+ROCKY_ABOUT(zstd, ZSTD_VERSION_STRING)
+#endif
+
 using namespace ROCKY_NAMESPACE;
 using namespace ROCKY_NAMESPACE::util;
 
@@ -682,6 +691,13 @@ rocky::util::readFromFile(std::string& data, const std::string& filename)
 #undef CHUNK
 #define CHUNK 32768
 
+ZLibCompressor::ZLibCompressor(std::size_t maxSize, bool raw) :
+    _maxSize(maxSize),
+    _raw(raw)
+{
+    //nop
+}
+
 bool
 ZLibCompressor::compress(const std::string& src, std::ostream& fout) const
 {
@@ -698,7 +714,7 @@ ZLibCompressor::compress(const std::string& src, std::ostream& fout) const
     strm.zfree = Z_NULL;
     strm.opaque = Z_NULL;
     ret = deflateInit2(&strm, level, Z_DEFLATED,
-        15 + 16, // +16 to use gzip encoding
+        _raw ? -15 : 15 + 16, // +16 to use gzip encoding
         8, // default
         stategy);
     if (ret != Z_OK) return false;
@@ -752,13 +768,16 @@ ZLibCompressor::decompress(std::istream& fin, std::string& target) const
     strm.avail_in = 0;
     strm.next_in = Z_NULL;
     ret = inflateInit2(&strm,
-        15 + 32); // autodetected zlib or gzip header
+        _raw ? -15 : 15 + 32); // no header, or autodetected zlib or gzip header
 
     if (ret != Z_OK)
     {
         return ret != 0;
     }
 
+    // a small input can inflate enormously, so stop at the limit
+    auto offset = target.size();
+
     /* decompress until deflate stream ends or end of file */
     do
     {
@@ -783,6 +802,12 @@ ZLibCompressor::decompress(std::istream& fin, std::string& target) const
                 return false;
             }
             have = CHUNK - strm.avail_out;
+            if (target.size() - offset + have > _maxSize)
+            {
+                (void)inflateEnd(&strm);
+                target.resize(offset);
+                return false;
+            }
             target.append((char*)out, have);
         } while (strm.avail_out == 0);
 
@@ -793,3 +818,189 @@ ZLibCompressor::decompress(std::istream& fin, std::string& target) const
     (void)inflateEnd(&strm);
     return ret == Z_STREAM_END ? true : false;
 }
+
+#ifdef ZSTD_FOUND
+namespace
+{
+    // zstd contexts are expensive to make and can't be shared, so keep one of each per thread
+    ZSTD_CCtx* zstd_compression_context()
+    {
+        thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+        return cctx.get();
+    }
+
+    ZSTD_DCtx* zstd_decompression_context()
+    {
+        thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+        return dctx.get();
+    }
+}
+#endif
+
+ZStdCompressor::ZStdCompressor(const std::string& dictionary, int level, std::size_t maxSize) :
+    _dictionary(dictionary),
+    _level(level),
+    _maxSize(maxSize)
+{
+#ifdef ZSTD_FOUND
+    // digest the dictionary once, up front, instead of on every call
+    if (!_dictionary.empty())
+    {
+        _cdict = shared_ptr<void>(
+            ZSTD_createCDict(_dictionary.data(), _dictionary.size(), _level),
+            [](void* p) { ZSTD_freeCDict((ZSTD_CDict*)p); });
+
+        _ddict = shared_ptr<void>(
+            ZSTD_createDDict(_dictionary.data(), _dictionary.size()),
+            [](void* p) { ZSTD_freeDDict((ZSTD_DDict*)p); });
+    }
+#endif
+}
+
+bool
+ZStdCompressor::available()
+{
+#ifdef ZSTD_FOUND
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string
+ZStdCompressor::train(const std::vector<std::string>& samples, std::size_t maxSize)
+{
+#ifdef ZSTD_FOUND
+    // zdict wants the samples end to end in one buffer
+    std::string buffer;
+    std::vector<std::size_t> sizes;
+    sizes.reserve(samples.size());
+    for (auto& sample : samples)
+    {
+        buffer.append(sample);
+        sizes.push_back(sample.size());
+    }
+
+    std::string dictionary(maxSize, '\0');
+    auto size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), buffer.data(), sizes.data(), (unsigned)sizes.size());
+    if (ZDICT_isError(size))
+    {
+        return {};
+    }
+
+    dictionary.resize(size);
+    return dictionary;
+#else
+    return {};
+#endif
+}
+
+bool
+ZStdCompressor::compress(const std::string& src, std::ostream& out) const
+{
+#ifdef ZSTD_FOUND
+    std::string buffer(ZSTD_compressBound(src.size()), '\0');
+
+    auto size = _cdict ?
+        ZSTD_compress_usingCDict(zstd_compression_context(), buffer.data(), buffer.size(), src.data(), src.size(), (const ZSTD_CDict*)_cdict.get()) :
+        ZSTD_compressCCtx(zstd_compression_context(), buffer.data(), buffer.size(), src.data(), src.size(), _level);
+
+    if (ZSTD_isError(size))
+    {
+        return false;
+    }
+
+    out.write(buffer.data(), size);
+    return !out.fail();
+#else
+    return false;
+#endif
+}
+
+bool
+ZStdCompressor::decompress(std::istream& in, std::string& out) const
+{
+    std::string src;
+    char chunk[CHUNK];
+    while (in.read(chunk, CHUNK) || in.gcount() > 0)
+    {
+        src.append(chunk, (std::size_t)in.gcount());
+    }
+    return decompress(src, out);
+}
+
+bool
+ZStdCompressor::decompress(const std::string& src, std::string& out) const
+{
+#ifdef ZSTD_FOUND
+    auto size = ZSTD_getFrameContentSize(src.data(), src.size());
+    if (size == ZSTD_CONTENTSIZE_ERROR)
+    {
+        return false;
+    }
+
+    auto offset = out.size();
+
+    // Other encoders (e.g. HTTP servers) may leave out the size or write
+    // several frames, so decode those piece by piece up to the limit.
+    if (size == ZSTD_CONTENTSIZE_UNKNOWN || ZSTD_findFrameCompressedSize(src.data(), src.size()) != src.size())
+    {
+        auto dctx = zstd_decompression_context();
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+        if (_ddict)
+            ZSTD_DCtx_refDDict(dctx, (const ZSTD_DDict*)_ddict.get());
+
+        ZSTD_inBuffer input = { src.data(), src.size(), 0 };
+        std::string chunk(ZSTD_DStreamOutSize(), '\0');
+        std::size_t result = 0;
+        bool ok = true;
+        while (ok && input.pos < input.size)
+        {
+            ZSTD_outBuffer output = { chunk.data(), chunk.size(), 0 };
+            result = ZSTD_decompressStream(dctx, &output, &input);
+            ok = !ZSTD_isError(result) && out.size() - offset + output.pos <= _maxSize;
+            if (ok)
+                out.append(chunk.data(), output.pos);
+        }
+
+        // flush anything still buffered; a nonzero result means the last frame is incomplete
+        while (ok && result != 0)
+        {
+            ZSTD_outBuffer output = { chunk.data(), chunk.size(), 0 };
+            result = ZSTD_decompressStream(dctx, &output, &input);
+            ok = !ZSTD_isError(result) && output.pos > 0 && out.size() - offset + output.pos <= _maxSize;
+            if (ok)
+                out.append(chunk.data(), output.pos);
+        }
+
+        // don't leave the dictionary attached for the one-shot calls
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+
+        if (!ok)
+            out.resize(offset);
+        return ok;
+    }
+
+    // compress() always records the original size in the frame, so we can
+    // decode in one shot right into the output. The size comes from the
+    // record itself, so don't trust it with more memory than we allow.
+    if (size > _maxSize)
+    {
+        return false;
+    }
+    out.resize(offset + size);
+
+    auto result = _ddict ?
+        ZSTD_decompress_usingDDict(zstd_decompression_context(), &out[offset], size, src.data(), src.size(), (const ZSTD_DDict*)_ddict.get()) :
+        ZSTD_decompressDCtx(zstd_decompression_context(), &out[offset], size, src.data(), src.size());
+
+    if (ZSTD_isError(result) || result != size)
+    {
+        out.resize(offset);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -25,6 +25,9 @@
 #include <functional>
 #include <chrono>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 
 class TiXmlDocument;
 
@@ -453,6 +456,15 @@ namespace ROCKY_NAMESPACE { namespace util
         //! @param out Data in which to store decompressed data
         //! @return True upon success
         virtual bool decompress(std::istream& in, std::string& out) const = 0;
+
+        //! Decompress data in memory.
+        //! @param src Data to decompress
+        //! @param out Data in which to store decompressed data
+        //! @return True upon success
+        virtual bool decompress(const std::string& src, std::string& out) const {
+            std::istringstream in(src);
+            return decompress(in, out);
+        }
     };
 
     /**
@@ -461,6 +473,62 @@ namespace ROCKY_NAMESPACE { namespace util
     class ROCKY_EXPORT ZLibCompressor : public StreamCompressor
     {
     public:
+        //! Construct a compressor.
+        //! @param maxSize Largest decompressed result to accept, in bytes; data
+        //!   that inflates to more fails to decompress
+        //! @param raw Use raw deflate data, without a zlib or gzip header
+        ZLibCompressor(std::size_t maxSize = 256u * 1024u * 1024u, bool raw = false);
+
+        using StreamCompressor::decompress;
+
+        //! Compress data to an output stream.
+        //! @param src Data to compress
+        //! @param out Stream to which to write compressed data
+        //! @return True upon success
+        bool compress(const std::string& src, std::ostream& out) const override;
+
+        //! Decompress data from a stream.
+        //! @param src Data to decompress
+        //! @param out Data in which to store decompressed data
+        //! @return True upon success
+        bool decompress(std::istream& in, std::string& out) const override;
+
+    private:
+        std::size_t _maxSize;
+        bool _raw;
+    };
+
+    /**
+    * Stream compressor that uses Zstandard compression, optionally with a
+    * dictionary trained on samples of similar data (see train()). Decodes
+    * several times faster than zlib. Compression fails if rocky was built
+    * without zstd; check available().
+    */
+    class ROCKY_EXPORT ZStdCompressor : public StreamCompressor
+    {
+    public:
+        //! Construct a compressor.
+        //! @param dictionary Dictionary made by train(), or empty for none
+        //! @param level Compression level (1..19); higher is smaller but slower to compress
+        //! @param maxSize Largest decompressed record to accept, in bytes; data
+        //!   decoding (or claiming to decode) to more fails to decompress
+        ZStdCompressor(const std::string& dictionary = {}, int level = 3, std::size_t maxSize = 256u * 1024u * 1024u);
+
+        //! Whether rocky was built with zstd support
+        static bool available();
+
+        //! Train a dictionary on sample data, which helps when compressing
+        //! many small records that look alike (like tiles).
+        //! @param samples Sample records
+        //! @param maxSize Largest dictionary to make, in bytes
+        //! @return Dictionary, or an empty string upon failure
+        static std::string train(const std::vector<std::string>& samples, std::size_t maxSize = 16384u);
+
+        //! Dictionary in use, or empty
+        const std::string& dictionary() const { return _dictionary; }
+
+        using StreamCompressor::decompress;
+
         //! Compress data to an output stream.
         //! @param src Data to compress
         //! @param out Stream to which to write compressed data
@@ -472,6 +540,19 @@ namespace ROCKY_NAMESPACE { namespace util
         //! @param out Data in which to store decompressed data
         //! @return True upon success
         bool decompress(std::istream& in, std::string& out) const override;
+
+        //! Decompress data in memory.
+        //! @param src Data to decompress
+        //! @param out Data in which to store decompressed data
+        //! @return True upon success
+        bool decompress(const std::string& src, std::string& out) const override;
+
+    private:
+        std::string _dictionary;
+        int _level;
+        std::size_t _maxSize;
+        shared_ptr<void> _cdict;
+        shared_ptr<void> _ddict;
     };
 
     // Adapted from https://www.geeksforgeeks.org/lru-cache-implementation
@@ -524,4 +605,246 @@ namespace ROCKY_NAMESPACE { namespace util
             map[key] = --cache.end();
         }
     };
+
+    /**
+     * Concurrent cache whose limit is a total "cost" (e.g. bytes) instead of an
+     * entry count. The cache is split into shards, each with its own lock and an
+     * equal share of the budget, so concurrent users rarely contend. A budget
+     * smaller than the shard count uses only as many shards as it can fill.
+     *
+     * Eviction is approximate LRU using the CLOCK algorithm: a hit only sets an
+     * atomic "referenced" flag under a shared lock, so readers of the same shard
+     * never block each other, and find() returns a shared handle to the value
+     * instead of a copy. Eviction order is per shard, and an entry costing more
+     * than one shard's share of the budget is not cached at all.
+     */
+    template<class K, class V>
+    class ShardedLRUCache
+    {
+    public:
+        //! Function returning the cost of an entry; nullptr means each entry costs 1
+        using CostFunction = std::function<std::size_t(const K&, const V&)>;
+
+        //! Shared, read-only handle to a cached value
+        using Handle = std::shared_ptr<const V>;
+
+        struct Stats
+        {
+            std::uint64_t gets = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t puts = 0;
+            std::uint64_t evictions = 0;
+            std::size_t entries = 0;
+            std::size_t cost = 0;
+        };
+
+        //! Construct a cache
+        //! @param budget Maximum total cost of all entries
+        //! @param cost Function returning an entry's cost
+        //! @param numShards Number of independently locked shards
+        ShardedLRUCache(std::size_t budget = 32u, CostFunction cost = nullptr, unsigned numShards = 16u) :
+            _cost(cost),
+            _budget(budget)
+        {
+            _shards.resize(std::max(numShards, 1u));
+            for (unsigned i = 0; i < _shards.size(); ++i) {
+                _shards[i] = std::make_unique<Shard>();
+                _shards[i]->index = i;
+            }
+            _active = activeShards(budget);
+        }
+
+        //! Change the budget, evicting entries as necessary
+        inline void setBudget(std::size_t value) {
+            std::vector<std::unique_lock<std::shared_mutex>> locks;
+            for (auto& shard : _shards)
+                locks.emplace_back(shard->mutex);
+
+            _budget = value;
+            unsigned active = activeShards(value);
+            if (active != _active) {
+                // keys now map to different shards; move the entries along
+                _active = active;
+                for (auto& shard : _shards) {
+                    for (auto entry = shard->ring.begin(); entry != shard->ring.end(); ) {
+                        auto next = std::next(entry);
+                        auto& target = shardFor(entry->key);
+                        if (&target != shard.get())
+                            move(*shard, entry, target);
+                        entry = next;
+                    }
+                }
+            }
+
+            for (auto& shard : _shards)
+                evict(*shard, shardBudget(*shard));
+        }
+
+        //! Maximum total cost of all entries
+        inline std::size_t budget() const {
+            return _budget;
+        }
+
+        //! Handle to a cached entry, or nullptr if it's not cached
+        inline Handle find(const K& key) {
+            auto& shard = shardFor(key);
+            ++shard.gets;
+            if (_budget == 0) return nullptr;
+            std::shared_lock L(shard.mutex);
+            auto it = shard.map.find(key);
+            if (it == shard.map.end())
+                return nullptr;
+            it->second->referenced.store(true, std::memory_order_relaxed);
+            ++shard.hits;
+            return it->second->value;
+        }
+
+        //! Copy of a cached entry, or a default-constructed V if it's not cached
+        inline V get(const K& key) {
+            auto handle = find(key);
+            return handle ? *handle : V();
+        }
+
+        //! Add or replace an entry
+        inline void put(const K& key, const V& value) {
+            std::size_t cost = _cost ? _cost(key, value) : 1u;
+            auto& shard = shardFor(key);
+            ++shard.puts;
+            std::unique_lock L(shard.mutex);
+            if (&shard != &shardFor(key))
+                return; // lost a race with setBudget, and would be unfindable there
+            auto it = shard.map.find(key);
+            if (it != shard.map.end())
+                erase(shard, it->second);
+            std::size_t limit = shardBudget(shard);
+            if (cost > limit)
+                return;
+            evict(shard, limit - cost);
+            // insert just behind the hand so the new entry is the last one it visits
+            auto entry = shard.ring.emplace(shard.hand, key, std::make_shared<const V>(value), cost);
+            shard.map[key] = entry;
+            shard.cost += cost;
+        }
+
+        //! Remove an entry if it exists
+        inline void remove(const K& key) {
+            auto& shard = shardFor(key);
+            std::unique_lock L(shard.mutex);
+            auto it = shard.map.find(key);
+            if (it != shard.map.end())
+                erase(shard, it->second);
+        }
+
+        //! Remove all entries
+        inline void clear() {
+            for (auto& shard : _shards) {
+                std::unique_lock L(shard->mutex);
+                shard->ring.clear();
+                shard->map.clear();
+                shard->hand = shard->ring.end();
+                shard->cost = 0;
+            }
+        }
+
+        //! Usage statistics
+        inline Stats stats() const {
+            Stats s;
+            for (auto& shard : _shards) {
+                s.gets += shard->gets;
+                s.hits += shard->hits;
+                s.puts += shard->puts;
+                s.evictions += shard->evictions;
+                std::shared_lock L(shard->mutex);
+                s.entries += shard->ring.size();
+                s.cost += shard->cost;
+            }
+            return s;
+        }
+
+    private:
+        struct Entry
+        {
+            Entry(const K& k, Handle v, std::size_t c) : key(k), value(v), cost(c) { }
+            K key;
+            Handle value;
+            std::size_t cost;
+            std::atomic<bool> referenced = { false };
+        };
+        using Ring = std::list<Entry>;
+
+        struct Shard
+        {
+            mutable std::shared_mutex mutex;
+            Ring ring;
+            typename Ring::iterator hand = ring.end();
+            std::unordered_map<K, typename Ring::iterator> map;
+            std::size_t cost = 0;
+            unsigned index = 0;
+            // per shard so counting doesn't make every thread share one cache line
+            std::atomic<std::uint64_t> gets = { 0 };
+            std::atomic<std::uint64_t> hits = { 0 };
+            std::atomic<std::uint64_t> puts = { 0 };
+            std::atomic<std::uint64_t> evictions = { 0 };
+        };
+
+        CostFunction _cost;
+        std::atomic<std::size_t> _budget;
+        std::atomic<unsigned> _active; // shards in use; keys only map to these
+        std::vector<std::unique_ptr<Shard>> _shards;
+
+        // no more shards than the budget can give at least 1 each
+        inline unsigned activeShards(std::size_t budget) const {
+            return (unsigned)std::max(std::min(budget, _shards.size()), std::size_t(1));
+        }
+
+        // equal shares of the budget, with the remainder going to the first shards
+        inline std::size_t shardBudget(const Shard& shard) const {
+            std::size_t budget = _budget;
+            unsigned active = _active;
+            if (shard.index >= active)
+                return 0;
+            return budget / active + (shard.index < budget % active ? 1 : 0);
+        }
+
+        inline Shard& shardFor(const K& key) {
+            return *_shards[std::hash<K>()(key) % _active];
+        }
+
+        // move an entry to another shard, keeping both hands valid (call with both exclusively locked)
+        inline void move(Shard& from, typename Ring::iterator entry, Shard& to) {
+            if (from.hand == entry)
+                ++from.hand;
+            from.cost -= entry->cost;
+            from.map.erase(entry->key);
+            to.ring.splice(to.hand, from.ring, entry);
+            to.map[entry->key] = entry;
+            to.cost += entry->cost;
+        }
+
+        // remove an entry, keeping the hand valid (call under an exclusive lock)
+        inline void erase(Shard& shard, typename Ring::iterator entry) {
+            shard.cost -= entry->cost;
+            shard.map.erase(entry->key);
+            if (shard.hand == entry)
+                shard.hand = shard.ring.erase(entry);
+            else
+                shard.ring.erase(entry);
+        }
+
+        // sweep the hand around the ring, giving referenced entries a second chance,
+        // until the shard's cost is within limit (call under an exclusive lock)
+        inline void evict(Shard& shard, std::size_t limit) {
+            while (shard.cost > limit && !shard.ring.empty()) {
+                if (shard.hand == shard.ring.end())
+                    shard.hand = shard.ring.begin();
+                if (shard.hand->referenced.exchange(false, std::memory_order_relaxed)) {
+                    ++shard.hand;
+                }
+                else {
+                    erase(shard, shard.hand);
+                    ++shard.evictions;
+                }
+            }
+        }
+    };
 } }
@@ -67,7 +67,7 @@ namespace
         if (result.status.ok())
         {
             TiXmlDocument doc;
-            doc.Parse(result.value.data.c_str());
+            doc.Parse(result.value.data.str().c_str());
             if (doc.Error() || !doc.RootElement())
             {
                 return Status(Status::GeneralError, util::make_string()
@@ -104,7 +104,7 @@ EarthFileImporter::read(const std::string& location, const IOOptions& io) const
 
     // try to parse the string into an XML document:
     TiXmlDocument doc;
-    doc.Parse(result.value.data.c_str());
+    doc.Parse(result.value.data.str().c_str());
     if (doc.Error() || !doc.RootElement())
     {
         return Status(Status::GeneralError, util::make_string()
@@ -27,7 +27,8 @@ namespace
 {
     // recursive search for a vsg::ReaderWriters that matches the extension
     // TODO: expand to include 'protocols' I guess
-    vsg::ref_ptr<vsg::ReaderWriter> findReaderWriter(const std::string& extension, const vsg::ReaderWriters& readerWriters)
+    vsg::ref_ptr<vsg::ReaderWriter> findReaderWriter(const std::string& extension, const vsg::ReaderWriters& readerWriters,
+        vsg::ReaderWriter::FeatureMask mask = vsg::ReaderWriter::FeatureMask::READ_ISTREAM)
     {
         vsg::ref_ptr<vsg::ReaderWriter> output;
 
@@ -37,7 +38,7 @@ namespace
             auto crw = dynamic_cast<vsg::CompositeReaderWriter*>(rw.get());
             if (crw)
             {
-                output = findReaderWriter(extension, crw->readerWriters);
+                output = findReaderWriter(extension, crw->readerWriters, mask);
             }
             else if (rw->getFeatures(features))
             {
@@ -45,7 +46,7 @@ namespace
 
                 if (j != features.extensionFeatureMap.end())
                 {
-                    if (j->second & vsg::ReaderWriter::FeatureMask::READ_ISTREAM)
+                    if (j->second & mask)
                     {
                         output = rw;
                     }
@@ -263,6 +264,14 @@ InstanceVSG::InstanceVSG() :
         std::istream& location, std::string contentType, const rocky::IOOptions& io)
         -> Result<shared_ptr<Image>>
     {
+        // rocky's own lossless format (e.g. floating point heightfields)
+        if (contentType.empty() || contentType == RAW_IMAGE_CONTENT_TYPE)
+        {
+            auto r = readRawImage(location);
+            if (r.status.code != Status::ResourceUnavailable)
+                return r;
+        }
+
         if (contentType.empty())
         {
             contentType = deduceContentTypeFromStream(location);
@@ -282,6 +291,43 @@ InstanceVSG::InstanceVSG() :
         }
         return Status(Status::ServiceUnavailable, "No image reader for \"" + contentType + "\"");
     };
+
+    // Same idea for writing an image to a stream (e.g. to store tiles in a database)
+    ioOptions().services().writeImageToStream = [readerWriterOptions](
+        shared_ptr<Image> image, std::ostream& location, std::string contentType, const rocky::IOOptions& io)
+        -> Status
+    {
+        if (!image)
+            return Status(Status::AssertionFailure);
+
+        // no codec writes R32_SFLOAT heightfields, so they need rocky's raw format
+        if (contentType == RAW_IMAGE_CONTENT_TYPE)
+            return writeRawImage(*image, location);
+
+        auto i = ext_for_mime_type.find(contentType);
+        if (i != ext_for_mime_type.end())
+        {
+            auto rw = findReaderWriter(i->second, readerWriterOptions->readerWriters,
+                vsg::ReaderWriter::FeatureMask::WRITE_OSTREAM);
+
+            if (rw != nullptr)
+            {
+                // moveImageToVSG consumes the image, so work on a copy; and flip it
+                // since the reader flips TOP_LEFT data on the way in.
+                auto copy = image->clone();
+                copy->flipVerticalInPlace();
+                auto data = util::moveImageToVSG(copy);
+
+                auto local_options = vsg::Options::create(*readerWriterOptions);
+                local_options->extensionHint = i->second;
+                if (rw->write(data, location, local_options))
+                    return StatusOK;
+
+                return Status(Status::GeneralError, "Failed to write \"" + contentType + "\" image");
+            }
+        }
+        return Status(Status::ServiceUnavailable, "No image writer for \"" + contentType + "\"");
+    };
 }
 
 InstanceVSG::InstanceVSG(vsg::CommandLine& args) :
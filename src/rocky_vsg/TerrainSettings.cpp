@@ -5,11 +5,14 @@
  */
 #include "TerrainSettings.h"
 #include "json.h"
+#include <rocky/Threading.h>
 
 using namespace ROCKY_NAMESPACE;
 
 TerrainSettings::TerrainSettings(const JSON& conf)
 {
+    concurrency.set_default(util::getConcurrency());
+
     const auto j = parse_json(conf);
 
     get_to(j, "tile_size", tileSize);
@@ -30,6 +33,7 @@ TerrainSettings::TerrainSettings(const JSON& conf)
     get_to(j, "morph_terrain", morphTerrain);
     get_to(j, "morph_imagery", morphImagery);
     get_to(j, "concurrency", concurrency);
+    get_to(j, "io_concurrency", ioConcurrency);
 }
 
 JSON
@@ -54,5 +58,6 @@ TerrainSettings::to_json() const
     set(j, "morph_terrain", morphTerrain);
     set(j, "morph_imagery", morphImagery);
     set(j, "concurrency", concurrency);
+    set(j, "io_concurrency", ioConcurrency);
     return j.dump();
 }
@@ -92,8 +92,15 @@ namespace ROCKY_NAMESPACE
         //! This feature is not available when using screen-space error LOD
         optional<bool> morphImagery = false;
 
-        //! Target concurrency of terrain data loading operations.
-        optional<unsigned> concurrency = 4;
+        //! Target concurrency of terrain data processing operations
+        //! (decoding, compositing, and building tile data).
+        //! Defaults to the number of CPU cores.
+        optional<unsigned> concurrency;
+
+        //! Target concurrency of terrain data fetching operations (network
+        //! and disk reads). These mostly wait on I/O, so this can safely be
+        //! much higher than the number of CPU cores.
+        optional<unsigned> ioConcurrency = 16;
 
     public: // internal runtime settings, not serialized.
 
@@ -187,66 +187,48 @@ Runtime::update()
 util::Future<bool>
 Runtime::compileAndAddChild(vsg::ref_ptr<vsg::Group> parent, NodeFactory factory, const util::job& job_config)
 {
-    // This is a two-step procedure. First we have to create the child
-    // by calling the Factory function, and compile it. These things happen 
-    // in the asynchronous function. Secondly, we have to add the node to the
-    // scene graph; this happens in VSG's update operations queue in some future
-    // frame.
-
-    // In order to return a future to the entire process, we will make our own
-    // Promise and pass it along to both the async part and then on to the sync
-    // update part. That way the user will be waiting on the final result of the
-    // scene graph merge.
-
-    util::Future<bool> promise;
-    auto& runtime = *this;
-    
-    auto viewer = runtime.viewer;
-    //auto compiler = runtime.compiler();
-    //auto updates = runtime.updates();
-
-    auto async_create_and_add_node = [viewer, promise, parent, factory](Cancelable& c) -> bool
+    // This is a three-step procedure. First we create the child by calling
+    // the Factory function, then we compile it; these are jobs chained with
+    // then(), so no thread waits in between. Last, we have to add the node to
+    // the scene graph; this happens in VSG's update operations queue in some
+    // future frame, so that hop is queued by hand.
+    //
+    // The returned future resolves once the child is compiled and its
+    // addition is queued.
+
+    auto viewer = this->viewer;
+
+    auto create_node = [factory](Cancelable& c) -> vsg::ref_ptr<vsg::Node>
     {
         if (c.canceled())
-            return false;
+            return { };
+
+        return factory(c);
+    };
 
-        // create the child:
-        auto child = factory(c);
-        if (!child)
+    auto compile_and_add_node = [viewer, parent](const vsg::ref_ptr<vsg::Node>& child, Cancelable& c) -> bool
+    {
+        if (!child || c.canceled())
             return false;
 
-        // compile the child:
         auto cr = viewer->compileManager->compile(child);
 
         // queue an update operation to add the child safely.
-        // we pass along the original promise so these two operations appear as
-        // one to the caller.
-        auto add_child = [parent, child, viewer, cr](Cancelable& c) -> bool
+        auto add_child = [parent, child, viewer, cr]()
         {
-            if (c.canceled())
-                return false;
-
-            if (parent && child)
+            if (parent)
                 parent->addChild(child);
 
             if (cr && cr.requiresViewerUpdate())
                 vsg::updateViewer(*viewer, cr);
-
-            return true;
-        };        
-        auto promise_op = util::PromiseOperation<bool>::create(promise, add_child);
-        viewer->updateOperations->add(promise_op);
+        };
+        viewer->updateOperations->add(SimpleUpdateOperation::create(add_child));
 
         return true;
     };
 
-    auto future = util::job::dispatch(
-        async_create_and_add_node,
-        promise,
-        job_config
-    );
-
-    return future;
+    return util::job::dispatch(create_node, job_config)
+        .then(compile_and_add_node, job_config);
 }
 
 void
@@ -76,7 +76,8 @@ namespace ROCKY_NAMESPACE
 
         //! Schedules data creation; the resulting node or nodes 
         //! get added to "parent" if the operation suceeds.
-        //! Returns a future so you can check for completion.
+        //! Returns a future that resolves once the node is compiled and
+        //! queued to be added during the next update.
         util::Future<bool> compileAndAddChild(
             vsg::ref_ptr<vsg::Group> parent,
             NodeFactory factory,
@@ -29,5 +29,17 @@ TerrainEngine::TerrainEngine(
     tiles(new_map->profile(), new_settings, host),
     stateFactory(new_runtime)
 {
-    util::job_scheduler::get(loadSchedulerName)->setConcurrency(4);
+    // Tile data comes from two lanes: a wide one that fetches raw data and
+    // spends most of its time waiting on the network or disk, and one sized
+    // to the CPU that decodes and assembles it.
+    auto scheduler = util::job_scheduler::get(loadSchedulerName);
+    scheduler->setConcurrency(settings.concurrency.value());
+
+    auto io_scheduler = util::job_scheduler::get(ioSchedulerName);
+    io_scheduler->setConcurrency(settings.ioConcurrency.value());
+
+    // tile loads can queue up by the thousands, so don't re-evaluate
+    // every tile's priority each time a worker takes a job
+    scheduler->setQueueMode(util::job_scheduler::queue_mode::heap);
+    io_scheduler->setQueueMode(util::job_scheduler::queue_mode::heap);
 }
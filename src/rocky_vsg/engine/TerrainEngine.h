@@ -52,7 +52,10 @@ namespace ROCKY_NAMESPACE
         //! Creates the state group objects for terrain rendering
         TerrainState stateFactory;
 
-        //! name of job arena used to load data
+        //! name of job arena used to load data (CPU-bound work)
         std::string loadSchedulerName = "terrain.load";
+
+        //! name of job arena used to fetch data (I/O-bound work)
+        std::string ioSchedulerName = "terrain.io";
     };
 }
@@ -245,6 +245,7 @@ TerrainTilePager::update(
     // are not thrashing tiles in and out of memory. Perhaps a simple
     // L2 cache of disposed tiles would be appropriate instead of
     // all these limits.
+    unsigned disposed = 0u;
     const auto dispose = [&](TerrainTileNode* tile)
     {
         if (!tile->doNotExpire)
@@ -261,12 +262,21 @@ TerrainTilePager::update(
                 }
             }
             _tiles.erase(key);
+            ++disposed;
             return true;
         }
         return false;
     };
 
     _tracker.flush(~0, dispose);
+
+    // Disposed tiles abandon their pending loads; take them out of the
+    // queue now instead of leaving them to clog it until a worker pops them.
+    if (disposed > 0)
+    {
+        util::job_scheduler::get(terrain->ioSchedulerName)->sweep();
+        util::job_scheduler::get(terrain->loadSchedulerName)->sweep();
+    }
 }
 
 vsg::ref_ptr<TerrainTileNode>
@@ -433,7 +443,34 @@ TerrainTilePager::requestLoadData(
 
     const IOOptions io(in_io);
 
-    auto load = [key, manifest, engine, io](Cancelable& p) -> TerrainTileModel
+    // Loading happens in two stages. First we fetch the raw data on the
+    // I/O lane, where threads can afford to wait on the network; then we
+    // decode and assemble it on the CPU lane, where the data will come from
+    // the I/O caches.
+    auto fetch = [key, manifest, engine, io](Cancelable& p) -> bool
+    {
+        if (p.canceled())
+        {
+            RP_DEBUG << "Data fetch " << key.str() << " CANCELED!" << std::endl;
+            return false;
+        }
+
+        util::timer timer;
+
+        TerrainTileModelFactory factory;
+
+        factory.prefetchTileModel(
+            engine->map.get(),
+            key,
+            manifest,
+            IOOptions(io, p));
+
+        engine->tiles._stageTimings.fetch.record(timer.milliseconds());
+
+        return true;
+    };
+
+    auto load = [key, manifest, engine, io](const bool&, Cancelable& p) -> TerrainTileModel
     {
         if (p.canceled())
         {
@@ -441,6 +478,8 @@ TerrainTilePager::requestLoadData(
             return { };
         }
 
+        util::timer timer;
+
         TerrainTileModelFactory factory;
 
         factory.compositeColorLayers = true;
@@ -451,6 +490,8 @@ TerrainTilePager::requestLoadData(
             manifest,
             IOOptions(io, p));
 
+        engine->tiles._stageTimings.create.record(timer.milliseconds());
+
         return model;
     };
 
@@ -463,7 +504,15 @@ TerrainTilePager::requestLoadData(
         return tile ? -(sqrt(tile->lastTraversalRange) * tile->key.levelOfDetail()) : 0.0f;
     };
 
-    tile->dataLoader = util::job::dispatch(
+    auto fetched = util::job::dispatch(
+        fetch, {
+            "fetch data " + key.str(),
+            priority_func,
+            util::job_scheduler::get(engine->ioSchedulerName),
+            nullptr
+        } );
+
+    tile->dataLoader = fetched.then(
         load, {
             "load data " + key.str(),
             priority_func,
@@ -499,7 +548,7 @@ TerrainTilePager::requestMergeData(
             return false;
         }
 
-        //util::scoped_chrono timer("merge sync " + key.str());
+        util::timer timer;
 
         auto tile = engine->tiles.getTile(key);
         if (!tile)
@@ -564,6 +613,8 @@ TerrainTilePager::requestMergeData(
             RP_DEBUG << "merge EMPTY TILE MODEL -> " << key.str() << std::endl;
         }
 
+        engine->tiles._stageTimings.merge.record(timer.milliseconds());
+
         return true;
     };
 
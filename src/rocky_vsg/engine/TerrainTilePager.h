@@ -7,7 +7,9 @@
 
 #include <rocky_vsg/Common.h>
 #include <rocky_vsg/engine/TerrainTileNode.h>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 
 namespace ROCKY_NAMESPACE
 {
@@ -37,6 +39,37 @@ namespace ROCKY_NAMESPACE
 
         using TileTable = std::unordered_map<TileKey, TableEntry>;
 
+        //! Cumulative time spent in each stage of producing tile data
+        struct StageTimings
+        {
+            struct Stage
+            {
+                std::atomic<std::uint64_t> count = { 0u };
+                std::atomic<std::uint64_t> microseconds = { 0u };
+
+                //! Adds one run of this stage
+                void record(double milliseconds) {
+                    ++count;
+                    microseconds += (std::uint64_t)(milliseconds * 1000.0);
+                }
+
+                //! Average time spent in this stage per tile
+                double averageMilliseconds() const {
+                    auto n = count.load();
+                    return n > 0 ? 0.001 * (double)microseconds.load() / (double)n : 0.0;
+                }
+            };
+
+            //! Fetching raw data (I/O lane)
+            Stage fetch;
+
+            //! Decoding, compositing, and building the tile model (CPU lane)
+            Stage create;
+
+            //! Merging the tile model into the tile (update thread)
+            Stage merge;
+        };
+
     public:
         //! Consturct the tile manager.
         TerrainTilePager(
@@ -77,6 +110,11 @@ namespace ROCKY_NAMESPACE
         //! @return The tile, if it exists
         vsg::ref_ptr<TerrainTileNode> getTile(const TileKey& key) const;
 
+        //! Time spent in each stage of producing tile data
+        const StageTimings& stageTimings() const {
+            return _stageTimings;
+        }
+
     protected:
 
         TileTable _tiles;
@@ -85,6 +123,7 @@ namespace ROCKY_NAMESPACE
         TerrainTileHost* _host;
         const TerrainSettings& _settings;
         bool _updateViewerRequired = false;
+        mutable StageTimings _stageTimings;
 
         std::vector<TileKey> _loadSubtiles;
         std::vector<TileKey> _loadElevation;
@@ -3,17 +3,24 @@
 
 #include <rocky/Instance.h>
 #include <rocky/Color.h>
+#include <rocky/FileCache.h>
 #include <rocky/Log.h>
 #include <rocky/Map.h>
 #include <rocky/Math.h>
 #include <rocky/Image.h>
+#include <rocky/IOTrace.h>
 #include <rocky/Heightfield.h>
 #include <rocky/TileKey.h>
+#include <rocky/Threading.h>
 #include <rocky/URI.h>
 #include <rocky/Utils.h>
 #include <rocky/contrib/EarthFileImporter.h>
 
+#include <cstring>
+#include <fstream>
+#include <numeric>
 #include <random>
+#include <set>
 
 #ifdef ROCKY_SUPPORTS_GDAL
 #include <rocky/GDALImageLayer.h>
@@ -23,6 +30,14 @@
 #include <rocky/TMSImageLayer.h>
 #endif
 
+#ifdef ROCKY_SUPPORTS_MBTILES
+#include <rocky/MBTiles.h>
+#endif
+
+#ifdef HTTPLIB_FOUND
+#include <httplib.h>
+#endif
+
 #define ROCKY_EXPOSE_JSON_FUNCTIONS
 #include <rocky/json.h>
 
@@ -164,6 +179,570 @@ TEST_CASE("Threading")
     CHECK(f2.value() == 123);
 }
 
+namespace
+{
+    // Queues one job per priority on a single-threaded scheduler while its
+    // only thread is held busy, then releases it and waits for the queue to
+    // drain. Returns the order in which the jobs ran and the drain time.
+    std::vector<float> drain_in_priority_order(
+        util::job_scheduler* scheduler,
+        const std::vector<float>& priorities,
+        double& milliseconds)
+    {
+        util::Event started, release;
+        util::job_group group;
+
+        auto blocker = util::job::dispatch([&](Cancelable&) {
+                started.set();
+                release.wait();
+                return true;
+            }, { "blocker", nullptr, scheduler, &group });
+
+        started.wait();
+
+        std::mutex order_mutex;
+        std::vector<float> order;
+        order.reserve(priorities.size());
+
+        std::vector<util::Future<bool>> jobs;
+        jobs.reserve(priorities.size());
+        for (auto p : priorities)
+        {
+            jobs.emplace_back(util::job::dispatch([&, p](Cancelable&) {
+                    std::scoped_lock lock(order_mutex);
+                    order.push_back(p);
+                    return true;
+                }, { "job", [p]() { return p; }, scheduler, &group }));
+        }
+
+        util::timer timer;
+        release.set();
+        group.join();
+        milliseconds = timer.milliseconds();
+
+        return order;
+    }
+}
+
+TEST_CASE("job_scheduler")
+{
+    using queue_mode = util::job_scheduler::queue_mode;
+
+    std::vector<float> priorities{ 3, 7, 1, 9, 5, 2, 8 };
+    std::vector<float> expected(priorities);
+    std::sort(expected.begin(), expected.end(), std::greater<float>());
+
+    for (auto mode : { queue_mode::scan, queue_mode::heap, queue_mode::stealing })
+    {
+        std::string name =
+            mode == queue_mode::scan ? "test.scan" :
+            mode == queue_mode::heap ? "test.heap" :
+            "test.stealing";
+        util::job_scheduler::setConcurrency(name, 1);
+        util::job_scheduler::setQueueMode(name, mode);
+
+        auto scheduler = util::job_scheduler::get(name);
+        REQUIRE(scheduler);
+        CHECK(scheduler->getQueueMode() == mode);
+
+        double ms;
+        auto order = drain_in_priority_order(scheduler, priorities, ms);
+
+        // stealing only orders jobs within each lane, so just make sure
+        // they all ran.
+        if (mode == queue_mode::stealing)
+            std::sort(order.begin(), order.end(), std::greater<float>());
+
+        CHECK(order == expected);
+    }
+
+    SECTION("Change queue mode with jobs queued")
+    {
+        util::job_scheduler::setConcurrency("test.switch", 1);
+        auto scheduler = util::job_scheduler::get("test.switch");
+        REQUIRE(scheduler);
+
+        util::Event started, release;
+        util::job_group group;
+        auto blocker = util::job::dispatch([&](Cancelable&) {
+                started.set();
+                release.wait();
+                return true;
+            }, { "blocker", nullptr, scheduler, &group });
+        started.wait();
+
+        std::atomic_int count = { 0 };
+        std::vector<util::Future<bool>> jobs;
+        for (int i = 0; i < 100; ++i)
+        {
+            jobs.emplace_back(util::job::dispatch([&](Cancelable&) {
+                    ++count;
+                    return true;
+                }, { "job", nullptr, scheduler, &group }));
+
+            if (i == 33) scheduler->setQueueMode(queue_mode::stealing);
+            if (i == 66) scheduler->setQueueMode(queue_mode::heap);
+        }
+
+        release.set();
+        group.join();
+        CHECK(count == 100);
+    }
+
+    SECTION("Dispatch to idle workers while the mode changes")
+    {
+        // a worker asleep in one mode must still wake for a job dispatched in another
+        util::job_scheduler::setConcurrency("test.idle", 2);
+        auto scheduler = util::job_scheduler::get("test.idle");
+        REQUIRE(scheduler);
+
+        std::atomic_bool stop = { false };
+        std::thread toggler([&]() {
+            for (unsigned i = 0; !stop; ++i)
+            {
+                scheduler->setQueueMode(i % 2 ? queue_mode::stealing : queue_mode::scan);
+                std::this_thread::yield();
+            }
+            });
+
+        unsigned stuck = 0;
+        for (int i = 0; i < 500 && stuck == 0; ++i)
+        {
+            auto job = util::job::dispatch([](Cancelable&) {
+                    return true;
+                }, { "job", nullptr, scheduler, nullptr });
+
+            auto start = std::chrono::steady_clock::now();
+            while (job.working() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+            if (!job.available())
+                ++stuck;
+        }
+
+        stop = true;
+        toggler.join();
+        CHECK(stuck == 0);
+    }
+
+    SECTION("Remove canceled jobs")
+    {
+        for (auto mode : { queue_mode::scan, queue_mode::heap, queue_mode::stealing })
+        {
+            std::string name =
+                mode == queue_mode::scan ? "test.sweep.scan" :
+                mode == queue_mode::heap ? "test.sweep.heap" :
+                "test.sweep.stealing";
+            util::job_scheduler::setConcurrency(name, 1);
+            util::job_scheduler::setQueueMode(name, mode);
+            auto scheduler = util::job_scheduler::get(name);
+
+            util::Event started, release;
+            auto blocker = util::job::dispatch([&](Cancelable&) {
+                    started.set();
+                    release.wait();
+                    return true;
+                }, { "blocker", nullptr, scheduler, nullptr });
+            started.wait();
+
+            // abandon half of the futures, then sweep
+            std::atomic_int count = { 0 };
+            std::vector<util::Future<bool>> jobs;
+            for (int i = 0; i < 100; ++i)
+            {
+                auto future = util::job::dispatch([&](Cancelable&) {
+                        ++count;
+                        return true;
+                    }, { "job", nullptr, scheduler, nullptr });
+
+                if (i % 2 == 0)
+                    jobs.emplace_back(future);
+            }
+            CHECK(scheduler->sweep() == 50);
+
+            // cancel a group, which sweeps on its own
+            util::job_group group;
+            std::vector<util::Future<bool>> grouped;
+            for (int i = 0; i < 10; ++i)
+            {
+                grouped.emplace_back(util::job::dispatch([&](Cancelable&) {
+                        ++count;
+                        return true;
+                    }, { "grouped", nullptr, scheduler, &group }));
+            }
+            group.cancel();
+            CHECK(group.canceled() == true);
+            CHECK(scheduler->sweep() == 0);
+            group.join(); // must not block
+
+            release.set();
+            for (auto& job : jobs)
+                job.join();
+            CHECK(count == 50);
+        }
+    }
+
+    SECTION("Adaptive concurrency")
+    {
+        util::job_scheduler::setConcurrency("test.adaptive", 1);
+        auto scheduler = util::job_scheduler::get("test.adaptive");
+        scheduler->setAdaptiveConcurrency(1, 8, std::chrono::milliseconds(20));
+
+        // jobs that mostly wait, like network reads, scale with more threads
+        std::atomic_uint highest = { 0u };
+        util::job_group group;
+        std::vector<util::Future<bool>> jobs;
+        for (int i = 0; i < 500; ++i)
+        {
+            jobs.emplace_back(util::job::dispatch([&](Cancelable&) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    unsigned value = scheduler->getConcurrency();
+                    unsigned prev = highest;
+                    while (value > prev && !highest.compare_exchange_weak(prev, value));
+                    return true;
+                }, { "job", nullptr, scheduler, &group }));
+        }
+        group.join();
+
+        CHECK(highest > 1u);
+        CHECK(highest <= 8u);
+    }
+}
+
+TEST_CASE("Future continuations")
+{
+    util::job_scheduler::setConcurrency("test.fetch", 2);
+    util::job_scheduler::setConcurrency("test.decode", 1);
+    util::job fetch{ "fetch", nullptr, util::job_scheduler::get("test.fetch"), nullptr };
+    util::job decode{ "decode", nullptr, util::job_scheduler::get("test.decode"), nullptr };
+
+    SECTION("then")
+    {
+        auto result = util::job::dispatch([](Cancelable&) { return 21; }, fetch)
+            .then([](const int& value, Cancelable&) { return value * 2; }, decode)
+            .then([](const int& value, Cancelable&) { return std::to_string(value); }, fetch);
+
+        CHECK(result.empty() == false);
+        CHECK(result.join() == "42");
+        CHECK(result.available() == true);
+
+        // continuing a resolved future dispatches right away
+        util::Future<int> resolved;
+        resolved.resolve(5);
+        auto next = resolved.then([](const int& value, Cancelable&) { return value + 1; });
+        CHECK(next.join() == 6);
+    }
+
+    SECTION("when_all and when_any")
+    {
+        std::vector<util::Future<int>> parts;
+        for (int i = 0; i < 10; ++i)
+            parts.emplace_back(util::job::dispatch([i](Cancelable&) { return i; }, fetch));
+
+        auto sum = util::when_all(parts).then([](const std::vector<int>& values, Cancelable&) {
+                return std::accumulate(values.begin(), values.end(), 0);
+            }, decode);
+        CHECK(sum.join() == 45);
+
+        auto first = util::when_any(parts);
+        CHECK(first.join() < parts.size());
+
+        CHECK(util::when_all(std::vector<util::Future<int>>{}).available() == true);
+    }
+
+    SECTION("Abandonment")
+    {
+        // a continuation waiting on a live future is not empty
+        util::Future<int> upstream;
+        auto next = upstream.then([](const int& value, Cancelable&) { return value; });
+        CHECK(next.empty() == false);
+        CHECK(next.working() == true);
+
+        // abandon the upstream future, and the continuation is abandoned too
+        upstream.abandon();
+        CHECK(next.empty() == true);
+
+        // abandon a continuation, and the stages feeding it never run
+        util::Event started, release;
+        auto blocker = util::job::dispatch([&](Cancelable&) {
+                started.set();
+                release.wait();
+                return true;
+            }, decode);
+        started.wait();
+
+        std::atomic_int ran = { 0 };
+        {
+            auto dropped = util::job::dispatch([&](Cancelable&) { return ++ran; }, decode)
+                .then([&](const int&, Cancelable&) { return ++ran; }, decode);
+        }
+        release.set();
+        blocker.join();
+        util::job::dispatch([](Cancelable&) { return true; }, decode).join();
+        CHECK(ran == 0);
+    }
+}
+
+TEST_CASE("Coalescer")
+{
+    util::Coalescer<int, int> inflight;
+    std::atomic_int calls = { 0 };
+    util::Event started, release;
+
+    auto work = [&]() {
+        started.set();
+        release.wait();
+        return ++calls;
+    };
+
+    SECTION("Concurrent callers share one result")
+    {
+        std::vector<int> results(4, 0);
+        std::vector<std::thread> threads;
+        threads.emplace_back([&]() { results[0] = inflight.get(7, work); });
+        started.wait();
+        for (int i = 1; i < 4; ++i)
+            threads.emplace_back([&, i]() { results[i] = inflight.get(7, work); });
+
+        // a different key doesn't wait
+        int other = inflight.get(8, []() { return 99; });
+        CHECK(other == 99);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        release.set();
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(calls == 1);
+        CHECK(inflight.coalesced == 3);
+        CHECK(std::count(results.begin(), results.end(), 1) == 4);
+
+        // once landed, the next call runs again
+        CHECK(inflight.get(7, work) == 2);
+    }
+
+    SECTION("Canceled result is not shared")
+    {
+        struct Flag : public Cancelable {
+            std::atomic_bool value = { false };
+            bool canceled() const override { return value; }
+        } leader_canceled;
+
+        int leader_result = 0, follower_result = 0;
+        std::thread leader([&]() { leader_result = inflight.get(7, work, &leader_canceled); });
+        started.wait();
+        std::thread follower([&]() { follower_result = inflight.get(7, work); });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        leader_canceled.value = true;
+        release.set();
+        leader.join();
+        follower.join();
+
+        // the follower had to do its own work
+        CHECK(leader_result == 1);
+        CHECK(follower_result == 2);
+        CHECK(inflight.coalesced == 0);
+    }
+}
+
+TEST_CASE("parallel_for")
+{
+    SECTION("Every index once")
+    {
+        std::vector<int> hits(10000, 0);
+        bool ok = util::parallel_for(0u, (unsigned)hits.size(), [&](unsigned i) { hits[i]++; });
+        CHECK(ok == true);
+        CHECK(std::count(hits.begin(), hits.end(), 1) == (long)hits.size());
+
+        // empty range is a no-op
+        ok = util::parallel_for(5, 5, [&](int) { hits[0]++; });
+        CHECK(ok == true);
+        CHECK(hits[0] == 1);
+
+        // negative indices
+        std::vector<int> signed_hits(10, 0);
+        ok = util::parallel_for(-5, 5, [&](int i) { signed_hits[i + 5]++; }, nullptr, 1);
+        CHECK(ok == true);
+        CHECK(std::count(signed_hits.begin(), signed_hits.end(), 1) == 10);
+
+        auto sum = util::parallel_reduce(-100, 0, 0,
+            [](int i, int& partial) { partial += i; },
+            [](int a, int b) { return a + b; });
+        CHECK(sum == -5050);
+    }
+
+    SECTION("Exceptions")
+    {
+        // the caller gets the exception, but only after every chunk is done with func
+        std::atomic_int running = { 0 }, count = { 0 };
+        bool thrown = false;
+        try
+        {
+            util::parallel_for(0, 1000, [&](int i) {
+                    ++running;
+                    ++count;
+                    if (i == 10)
+                        throw std::runtime_error("chunk failed");
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    --running;
+                }, nullptr, 1);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        // only the throwing call is still counted as running
+        CHECK(running == 1);
+        CHECK(count < 1000);
+
+        // and the pool is still usable
+        bool ok = util::parallel_for(0, 100, [](int) { });
+        CHECK(ok == true);
+    }
+
+    SECTION("parallel_reduce")
+    {
+        auto sum = util::parallel_reduce(1, 10001, (long long)0,
+            [](int i, long long& partial) { partial += i; },
+            [](long long a, long long b) { return a + b; });
+        CHECK(sum == 50005000ll);
+
+        // partials combine in index order, so non-commutative reductions work
+        auto text = util::parallel_reduce(0, 26, std::string(),
+            [](int i, std::string& partial) { partial += (char)('a' + i); },
+            [](const std::string& a, const std::string& b) { return a + b; },
+            nullptr, 3);
+        CHECK(text == "abcdefghijklmnopqrstuvwxyz");
+    }
+
+    SECTION("Called from inside a job")
+    {
+        // saturate a one-thread pool with jobs that each run a parallel_for;
+        // the caller always participates, so none of them can deadlock.
+        util::job_scheduler::setConcurrency("test.parallel", 1);
+        util::job config{ "outer", nullptr, util::job_scheduler::get("test.parallel"), nullptr };
+
+        std::vector<util::Future<int>> outer;
+        for (int j = 0; j < 8; ++j)
+        {
+            outer.emplace_back(util::job::dispatch([](Cancelable&) {
+                    return util::parallel_reduce(0, 1000, 0,
+                        [](int i, int& partial) {
+                            partial += util::parallel_reduce(0, 10, 0,
+                                [](int, int& p) { p++; },
+                                [](int a, int b) { return a + b; });
+                        },
+                        [](int a, int b) { return a + b; });
+                }, config));
+        }
+
+        for (auto& f : outer)
+            CHECK(f.join() == 10000);
+    }
+
+    SECTION("Cancelation")
+    {
+        struct Flag : public Cancelable {
+            std::atomic_bool value = { false };
+            bool canceled() const override { return value; }
+        } flag;
+
+        std::atomic_int count = { 0 };
+        bool ok = util::parallel_for(0, 10000, [&](int i) {
+                if (++count == 100)
+                    flag.value = true;
+            }, &flag, 10);
+
+        CHECK(ok == false);
+        CHECK(count < 10000);
+    }
+}
+
+// Run with: rtests "[benchmark]"
+TEST_CASE("job_scheduler dequeue benchmark", "[.][benchmark]")
+{
+    using queue_mode = util::job_scheduler::queue_mode;
+
+    std::mt19937 engine(0);
+    std::uniform_real_distribution<float> prng(0.0f, 1000.0f);
+
+    for (unsigned depth : { 256u, 1024u, 4096u, 16384u })
+    {
+        std::vector<float> priorities(depth);
+        for (auto& p : priorities)
+            p = prng(engine);
+
+        for (auto mode : { queue_mode::scan, queue_mode::heap })
+        {
+            std::string name = (mode == queue_mode::scan ? "bench.scan." : "bench.heap.") + std::to_string(depth);
+            util::job_scheduler::setConcurrency(name, 1);
+            util::job_scheduler::setQueueMode(name, mode);
+
+            double ms;
+            drain_in_priority_order(util::job_scheduler::get(name), priorities, ms);
+
+            std::cout << (mode == queue_mode::scan ? "scan" : "heap")
+                << " depth=" << depth
+                << " total=" << ms << "ms"
+                << " per_dequeue=" << (ms * 1e3) / (double)depth << "us"
+                << std::endl;
+        }
+    }
+
+    // Throughput of many tiny jobs on all cores, where queue contention dominates.
+    // Each job spawns a few more so worker-local dispatch is exercised too.
+    const unsigned threads = util::getConcurrency();
+    const unsigned roots = 5000, children = 4;
+
+    for (auto mode : { queue_mode::scan, queue_mode::heap, queue_mode::stealing })
+    {
+        std::string name =
+            mode == queue_mode::scan ? "bench.contention.scan" :
+            mode == queue_mode::heap ? "bench.contention.heap" :
+            "bench.contention.stealing";
+        util::job_scheduler::setConcurrency(name, threads);
+        util::job_scheduler::setQueueMode(name, mode);
+        auto scheduler = util::job_scheduler::get(name);
+
+        std::atomic_uint count = { 0 };
+        util::job_group group;
+
+        // hold on to all the futures, or the jobs will cancel themselves
+        using Children = std::vector<util::Future<bool>>;
+        std::vector<util::Future<Children>> jobs;
+        jobs.reserve(roots);
+
+        util::timer timer;
+        for (unsigned i = 0; i < roots; ++i)
+        {
+            jobs.emplace_back(util::job::dispatch([&](Cancelable&) {
+                    Children spawned;
+                    for (unsigned c = 0; c < children; ++c)
+                    {
+                        spawned.emplace_back(util::job::dispatch([&](Cancelable&) {
+                                ++count;
+                                return true;
+                            }, { "child", nullptr, scheduler, &group }));
+                    }
+                    ++count;
+                    return spawned;
+                }, { "root", []() { return 1.0f; }, scheduler, &group }));
+        }
+        group.join();
+        auto ms = timer.milliseconds();
+
+        std::cout << scheduler->getConcurrency() << " threads "
+            << (mode == queue_mode::scan ? "scan" : mode == queue_mode::heap ? "heap" : "stealing")
+            << " jobs=" << count
+            << " total=" << ms << "ms"
+            << " jobs_per_ms=" << (double)count / ms
+            << std::endl;
+    }
+}
+
 TEST_CASE("Math")
 {
     CHECK(is_identity(glm::fmat4(1)));
@@ -207,6 +786,159 @@ TEST_CASE("Compression")
 
     // ensure the decompressed stream matched the original data
     CHECK(decompressed_data == original_data);
+
+    // raw deflate, without a header, needs to be asked for
+    std::stringstream raw_output;
+    REQUIRE(util::ZLibCompressor(1024u * 1024u, true).compress(original_data, raw_output) == true);
+    std::string raw_decompressed;
+    std::istringstream raw_input(raw_output.str());
+    CHECK(util::ZLibCompressor(1024u * 1024u, true).decompress(raw_input, raw_decompressed) == true);
+    CHECK(raw_decompressed == original_data);
+    raw_decompressed.clear();
+    CHECK(util::ZLibCompressor().decompress(raw_output.str(), raw_decompressed) == false);
+
+    // output past the limit fails
+    std::string capped;
+    CHECK(util::ZLibCompressor(original_data.size() - 1).decompress(compressed_data, capped) == false);
+    CHECK(capped.empty());
+
+    if (util::ZStdCompressor::available())
+    {
+        // records that look alike, to train a dictionary on
+        std::vector<std::string> samples;
+        for (unsigned i = 0; i < 200; ++i)
+            samples.emplace_back("{ \"name\": \"tile\", \"index\": " + std::to_string(i) + ", \"data\": \"" + original_data.substr(i, 64) + "\" }");
+
+        auto dictionary = util::ZStdCompressor::train(samples, 1024u);
+        CHECK(!dictionary.empty());
+
+        for (auto& zstd : { util::ZStdCompressor(), util::ZStdCompressor(dictionary) })
+        {
+            std::stringstream zstd_output;
+            REQUIRE(zstd.compress(original_data, zstd_output) == true);
+
+            std::string zstd_decompressed;
+            CHECK(zstd.decompress(zstd_output.str(), zstd_decompressed) == true);
+            CHECK(zstd_decompressed == original_data);
+
+            // also through the stream interface
+            zstd_decompressed.clear();
+            CHECK(zstd.decompress(zstd_output, zstd_decompressed) == true);
+            CHECK(zstd_decompressed == original_data);
+        }
+
+        // the dictionary pays off on small records
+        std::stringstream plain, trained;
+        util::ZStdCompressor().compress(samples[100], plain);
+        util::ZStdCompressor(dictionary).compress(samples[100], trained);
+        CHECK(trained.str().size() < plain.str().size());
+
+        // and decoding with the wrong dictionary fails cleanly
+        std::string wrong;
+        CHECK(util::ZStdCompressor().decompress(trained.str(), wrong) == false);
+
+        // records claiming more than the limit are refused without allocating it
+        std::stringstream big;
+        util::ZStdCompressor().compress(std::string(1024u * 1024u, 'x'), big);
+        std::string capped = "prefix";
+        CHECK(util::ZStdCompressor({}, 3, 1024u).decompress(big.str(), capped) == false);
+        CHECK(capped == "prefix");
+        CHECK(util::ZStdCompressor({}, 3, 1024u * 1024u).decompress(big.str(), capped) == true);
+
+        // several frames back to back (as a server might stream them) decode piece by piece
+        std::stringstream frames;
+        util::ZStdCompressor().compress(original_data, frames);
+        util::ZStdCompressor().compress(samples[0], frames);
+        std::string joined;
+        CHECK(util::ZStdCompressor().decompress(frames.str(), joined) == true);
+        CHECK(joined == original_data + samples[0]);
+        joined.clear();
+        CHECK(util::ZStdCompressor({}, 3, original_data.size()).decompress(frames.str(), joined) == false);
+        CHECK(joined.empty());
+    }
+}
+
+TEST_CASE("Compression benchmark", "[.][benchmark]")
+{
+    // Size and decode speed of zlib vs. zstd on tiles like the ones we keep
+    // in MBTiles: float32 elevation grids and RGBA imagery.
+    if (!util::ZStdCompressor::available())
+    {
+        WARN("Built without zstd");
+        return;
+    }
+
+    std::mt19937 engine(0);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const unsigned count = 100;
+
+    std::vector<std::string> elevation, imagery;
+    for (unsigned t = 0; t < count; ++t)
+    {
+        // rolling terrain with a little roughness, quantized to 10cm like most DEMs
+        std::vector<float> heights(257 * 257);
+        for (unsigned j = 0; j < 257; ++j)
+            for (unsigned i = 0; i < 257; ++i)
+                heights[j * 257 + i] = std::round(10.0f * (1500.0f
+                    + 800.0f * std::sin((float)(i + t * 256) * 0.011f) * std::cos((float)j * 0.017f)
+                    + 3.0f * noise(engine))) * 0.1f;
+        elevation.emplace_back((const char*)heights.data(), heights.size() * sizeof(float));
+
+        // smooth colors with sensor noise and an opaque alpha
+        std::vector<unsigned char> pixels(256 * 256 * 4);
+        for (unsigned k = 0; k < 256 * 256; ++k)
+        {
+            float v = std::sin((float)(k % 256 + t * 256) * 0.02f) * std::cos((float)(k / 256) * 0.03f);
+            for (unsigned c = 0; c < 3; ++c)
+                pixels[k * 4 + c] = (unsigned char)std::clamp(128.0f + 60.0f * v * (float)(c + 1) / 3.0f + 4.0f * noise(engine), 0.0f, 255.0f);
+            pixels[k * 4 + 3] = 255;
+        }
+        imagery.emplace_back((const char*)pixels.data(), pixels.size());
+    }
+
+    auto run = [](const std::string& name, const util::StreamCompressor& compressor, const std::vector<std::string>& tiles)
+        {
+            std::vector<std::string> compressed;
+            std::size_t raw = 0, size = 0;
+            for (auto& tile : tiles)
+            {
+                std::ostringstream out;
+                REQUIRE(compressor.compress(tile, out));
+                compressed.emplace_back(out.str());
+                raw += tile.size();
+                size += compressed.back().size();
+            }
+
+            const unsigned passes = 5;
+            util::timer timer;
+            for (unsigned p = 0; p < passes; ++p)
+            {
+                for (auto& data : compressed)
+                {
+                    std::string out;
+                    REQUIRE(compressor.decompress(data, out));
+                }
+            }
+            auto ms = timer.milliseconds();
+
+            std::cout << name
+                << " size=" << size / 1024 << "KB"
+                << " ratio=" << (double)raw / (double)size
+                << " decode=" << ((double)(raw * passes) / 1048576.0) / (ms * 0.001) << "MB/s"
+                << std::endl;
+        };
+
+    for (auto* set : { &elevation, &imagery })
+    {
+        auto label = std::string(set == &elevation ? "elevation" : "imagery");
+
+        // train on a quarter of the tiles, as the MBTiles driver does with the first ones written
+        std::vector<std::string> samples(set->begin(), set->begin() + count / 4);
+
+        run(label + " zlib", util::ZLibCompressor(), *set);
+        run(label + " zstd", util::ZStdCompressor(), *set);
+        run(label + " zstd+dictionary", util::ZStdCompressor(util::ZStdCompressor::train(samples, 65536u)), *set);
+    }
 }
 
 TEST_CASE("Image")
@@ -284,6 +1016,43 @@ TEST_CASE("Heightfield")
     }
 }
 
+TEST_CASE("Raw image format")
+{
+    // the default writer service stores float heightfields losslessly..
+    IOOptions io;
+    auto hf = Heightfield::create(65, 65);
+    for (unsigned r = 0; r < 65; ++r)
+        for (unsigned c = 0; c < 65; ++c)
+            hf->heightAt(c, r) = (float)c * 0.25f - (float)r * 1000.5f;
+    hf->heightAt(3, 7) = NO_DATA_VALUE;
+
+    std::stringstream buf;
+    REQUIRE(io.services().writeImageToStream(hf, buf, RAW_IMAGE_CONTENT_TYPE, io).ok());
+
+    // ..and the reader recognizes them without a content type
+    auto r = io.services().readImageFromStream(buf, {}, io);
+    REQUIRE(r.status.ok());
+    REQUIRE(r.value->pixelFormat() == Image::R32_SFLOAT);
+    REQUIRE(r.value->sizeInBytes() == hf->sizeInBytes());
+    CHECK(std::memcmp(r.value->data<char>(), hf->data<char>(), hf->sizeInBytes()) == 0);
+
+    // other formats need a codec
+    std::stringstream png;
+    CHECK(io.services().writeImageToStream(hf, png, "image/png", io).code == Status::ServiceUnavailable);
+
+    // a header that claims more pixels than there are is rejected before allocating them
+    std::string truncated = buf.str().substr(0, 64);
+    std::uint32_t huge = 1u << 30;
+    std::memcpy(&truncated[8], &huge, sizeof(huge));
+    std::istringstream in(truncated);
+    CHECK(readRawImage(in).status.failed());
+
+    // non-raw data is left untouched for another reader
+    std::istringstream other("GIF89a...");
+    CHECK(readRawImage(other).status.code == Status::ResourceUnavailable);
+    CHECK(other.tellg() == 0);
+}
+
 TEST_CASE("Map")
 {
     Instance instance;
@@ -342,8 +1111,394 @@ TEST_CASE("GDAL")
         CHECK(s.ok());
     }
 }
+
+TEST_CASE("GDAL driver pool")
+{
+    // drivers are never opened here; the pool only hands them around
+    GDAL::DriverPool pool;
+    pool.setMaxSize(2u);
+    auto factory = []() { return std::make_shared<GDAL::Driver>(); };
+
+    // a failed open doesn't use up a slot
+    auto failed = pool.acquire([]() { return shared_ptr<GDAL::Driver>(); });
+    CHECK(!failed);
+    CHECK(pool.stats().open == 0);
+
+    // a returned driver is reused, not reopened
+    {
+        auto first = pool.acquire(factory);
+        CHECK(first);
+    }
+    auto first = pool.acquire(factory);
+    auto second = pool.acquire(factory);
+    CHECK((first && second));
+    CHECK(pool.stats().created == 2);
+    CHECK(pool.stats().open == 2);
+
+    // at the limit, acquire() waits for a driver to come back..
+    std::thread releaser([&]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            second.release();
+        });
+    auto third = pool.acquire(factory);
+    releaser.join();
+    CHECK(third);
+    CHECK(pool.stats().waits == 1);
+    CHECK(pool.stats().created == 2);
+
+    // ..or until the caller cancels
+    struct Canceled : public Cancelable {
+        bool canceled() const override { return true; }
+    } canceled;
+    auto fourth = pool.acquire(factory, &canceled);
+    CHECK(!fourth);
+
+    third.release();
+
+    // clearing closes idle drivers now, and busy ones when they come back
+    pool.clear();
+    CHECK(pool.stats().open == 1);
+    first.release();
+    CHECK(pool.stats().open == 0);
+
+    // many threads share a few drivers
+    pool.setMaxSize(3u);
+    std::atomic<unsigned> busy = { 0u }, most = { 0u };
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 16; ++t)
+    {
+        threads.emplace_back([&]()
+            {
+                for (unsigned i = 0; i < 20; ++i)
+                {
+                    auto driver = pool.acquire(factory);
+                    unsigned now = ++busy;
+                    unsigned prev = most;
+                    while (now > prev && !most.compare_exchange_weak(prev, now));
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    --busy;
+                }
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    CHECK(most <= 3u);
+    CHECK(pool.stats().peak <= 3u);
+    CHECK(pool.stats().checkouts == 4 + 16 * 20);
+}
+
+TEST_CASE("GDAL heightfield sampling")
+{
+    // createHeightfield reads a window and interpolates it in memory; it must
+    // agree post by post with sampling the dataset one point at a time.
+    Instance instance; // registers the GDAL drivers
+
+    // 45x45 float DEM covering exactly tile 4/16/3 of the global-geodetic profile
+    const int size = 45;
+    const double xmin = 0.0, ymax = 56.25, pixel = 11.25 / size;
+    const float nodata = -9999.0f;
+
+    auto base = std::filesystem::temp_directory_path() / "rocky_test_sampling";
+    auto bil = base, hdr = base, prj = base;
+    bil += ".bil", hdr += ".hdr", prj += ".prj";
+    {
+        std::ofstream out(hdr);
+        out << "BYTEORDER I\nLAYOUT BIL\nNROWS " << size << "\nNCOLS " << size << "\nNBANDS 1\nNBITS 32\nPIXELTYPE FLOAT\n"
+            << "ULXMAP " << xmin + pixel / 2 << "\nULYMAP " << ymax - pixel / 2 << "\n"
+            << "XDIM " << pixel << "\nYDIM " << pixel << "\nNODATA " << nodata << "\n";
+    }
+    {
+        std::ofstream out(prj);
+        out << R"(GEOGCS["GCS_WGS_1984",DATUM["D_WGS_1984",SPHEROID["WGS_1984",6378137.0,298.257223563]],PRIMEM["Greenwich",0.0],UNIT["Degree",0.0174532925199433]])";
+    }
+    {
+        std::vector<float> heights(size * size);
+        for (int y = 0; y < size; ++y)
+            for (int x = 0; x < size; ++x)
+                heights[y * size + x] = 500.0f + 300.0f * std::sin(x * 0.3f) * std::cos(y * 0.2f) + 2.0f * x * y;
+
+        // holes inside the data and on its edges
+        heights[10 * size + 10] = heights[5 * size + 30] = heights[44 * size + 0] = heights[0 * size + 44] = nodata;
+
+        std::ofstream out(bil, std::ios_base::binary);
+        out.write((const char*)heights.data(), heights.size() * sizeof(float));
+    }
+
+    const Profile& profile = Profile::GLOBAL_GEODETIC;
+    const unsigned tileSize = 33;
+    IOOptions io;
+
+    for (auto interpolation : { Image::BILINEAR, Image::AVERAGE, Image::NEAREST })
+    {
+        auto layer = GDALImageLayer::create(); // any GDAL::LayerBase will do
+        layer->setURI(URI(bil.string()));
+        layer->setInterpolation(interpolation);
+
+        GDAL::Driver driver;
+        REQUIRE(driver.open("test", layer.get(), tileSize, nullptr, io).ok());
+
+        // the tile matching the raster (its edge posts are half a pixel outside the
+        // pixel centers), and its parent, which the raster only partly covers
+        for (auto key : { TileKey(4, 16, 3, profile), TileKey(3, 8, 1, profile) })
+        {
+            auto r = driver.createHeightfield(key, tileSize, io);
+            REQUIRE(r.status.ok());
+            auto hf = r.value;
+
+            double kxmin, kymin, kxmax, kymax;
+            key.extent().getBounds(kxmin, kymin, kxmax, kymax);
+
+            unsigned holes = 0, mismatches = 0;
+            for (unsigned row = 0; row < tileSize; ++row)
+            {
+                for (unsigned col = 0; col < tileSize; ++col)
+                {
+                    float actual = hf->heightAt(col, row);
+
+                    // band nodata never leaks into the heights
+                    if (actual == nodata)
+                        ++mismatches;
+
+                    // nearest-neighbour tiles are resampled by GDAL, so only the above applies
+                    if (interpolation == Image::NEAREST)
+                        continue;
+
+                    float expected = driver.heightAt(
+                        kxmin + (kxmax - kxmin) * (double)col / (double)(tileSize - 1),
+                        kymin + (kymax - kymin) * (double)row / (double)(tileSize - 1));
+
+                    if (expected == NO_DATA_VALUE)
+                    {
+                        ++holes;
+                        if (actual != NO_DATA_VALUE)
+                            ++mismatches;
+                    }
+                    else if (std::abs(actual - expected) > 1e-3f * std::max(1.0f, std::abs(expected)))
+                    {
+                        ++mismatches;
+                    }
+                }
+            }
+
+            CHECK(mismatches == 0);
+            if (interpolation != Image::NEAREST)
+                CHECK(holes > 0);
+        }
+    }
+
+    std::filesystem::remove(bil);
+    std::filesystem::remove(hdr);
+    std::filesystem::remove(prj);
+}
+
+TEST_CASE("GDAL overviews benchmark", "[.][benchmark]")
+{
+    // Time per tile across an LOD sweep of a global RGB raster that has no
+    // overviews, reading it at full resolution vs. from in-memory overviews.
+    Instance instance; // registers the GDAL drivers
+
+    const int width = 8192, height = 4096;
+    auto base = std::filesystem::temp_directory_path() / "rocky_test_overviews";
+    auto bsq = base, hdr = base, prj = base;
+    bsq += ".bsq", hdr += ".hdr", prj += ".prj";
+
+    {
+        // ESRI band-sequential raster with a header, which GDAL reads directly
+        std::ofstream out(hdr);
+        out << "BYTEORDER I\nLAYOUT BSQ\nNROWS " << height << "\nNCOLS " << width << "\nNBANDS 3\nNBITS 8\n"
+            << "ULXMAP " << -180.0 + 180.0 / width << "\nULYMAP " << 90.0 - 90.0 / height << "\n"
+            << "XDIM " << 360.0 / width << "\nYDIM " << 180.0 / height << "\n";
+    }
+    {
+        std::ofstream out(prj);
+        out << R"(GEOGCS["GCS_WGS_1984",DATUM["D_WGS_1984",SPHEROID["WGS_1984",6378137.0,298.257223563]],PRIMEM["Greenwich",0.0],UNIT["Degree",0.0174532925199433]])";
+    }
+    {
+        std::ofstream out(bsq, std::ios_base::binary);
+        std::vector<unsigned char> row(width);
+        for (int band = 0; band < 3; ++band)
+        {
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                    row[x] = (unsigned char)(128.0 + 100.0 * std::sin(x * 0.01 * (band + 1)) * std::cos(y * 0.013));
+                out.write((const char*)row.data(), row.size());
+            }
+        }
+    }
+
+    const Profile& profile = Profile::GLOBAL_GEODETIC;
+    const unsigned maxLOD = 5;
+
+    for (bool buildOverviews : { false, true })
+    {
+        auto layer = GDALImageLayer::create();
+        layer->setURI(URI(bsq.string()));
+        layer->setBuildOverviews(buildOverviews);
+        REQUIRE(layer->open().ok());
+
+        std::cout << (buildOverviews ? "in-memory overviews" : "full resolution") << std::endl;
+
+        // the first low-LOD read builds the overviews
+        util::timer first;
+        REQUIRE(layer->createImage(TileKey(0, 0, 0, profile)).status.ok());
+        std::cout << "  first tile " << first.milliseconds() << " ms" << std::endl;
+
+        for (unsigned lod = 0; lod <= maxLOD; ++lod)
+        {
+            auto [cols, rows] = profile.numTiles(lod);
+            const unsigned samples = std::min(cols * rows, 16u);
+
+            util::timer timer;
+            for (unsigned i = 0; i < samples; ++i)
+            {
+                unsigned t = i * (cols * rows) / samples;
+                auto result = layer->createImage(TileKey(lod, t % cols, t / cols, profile));
+                REQUIRE(result.status.ok());
+            }
+            std::cout << "  lod " << lod << ": " << timer.milliseconds() / samples << " ms/tile" << std::endl;
+        }
+
+        layer->close();
+    }
+
+    std::filesystem::remove(bsq);
+    std::filesystem::remove(hdr);
+    std::filesystem::remove(prj);
+}
 #endif // ROCKY_SUPPORTS_GDAL
 
+#ifdef ROCKY_SUPPORTS_MBTILES
+TEST_CASE("MBTiles")
+{
+    auto path = std::filesystem::temp_directory_path() / "rocky_test.mbtiles";
+    std::filesystem::remove(path);
+
+    // trivial codec: size, then raw RGBA pixels
+    IOOptions io;
+    io.services().writeImageToStream = [](shared_ptr<Image> image, std::ostream& out, std::string, const IOOptions&)
+        {
+            out << image->width() << ' ' << image->height() << ' ';
+            out.write(image->data<char>(), image->sizeInBytes());
+            return StatusOK;
+        };
+    io.services().readImageFromStream = [](std::istream& in, std::string, const IOOptions&) -> Result<shared_ptr<Image>>
+        {
+            unsigned width = 0, height = 0;
+            in >> width >> height;
+            in.get();
+            auto image = Image::create(Image::R8G8B8A8_UNORM, width, height);
+            in.read(image->data<char>(), image->sizeInBytes());
+            return image;
+        };
+
+    MBTiles::Options options;
+    options.uri = URI(path.string());
+
+    SECTION("Commit every write")
+    {
+    }
+    SECTION("Batched writes")
+    {
+        options.batchSize = 16u;
+    }
+    if (util::ZStdCompressor::available())
+    {
+        SECTION("Zstd compression")
+        {
+            options.compress = true;
+            options.compression = "zstd";
+            options.batchSize = 16u;
+        }
+        SECTION("Zstd compression with a dictionary")
+        {
+            options.compress = true;
+            options.compression = "zstd";
+            options.dictionarySize = 1024u;
+        }
+    }
+
+    const unsigned lod = 3;
+    const Profile& profile = Profile::GLOBAL_GEODETIC;
+    const unsigned cols = profile.numTiles(lod).first;
+    const unsigned rows = profile.numTiles(lod).second;
+
+    {
+        MBTiles::Driver writer;
+        Profile p = profile;
+        DataExtentList extents;
+        REQUIRE(writer.open("test", options, true, p, extents, io).ok());
+
+        for (unsigned y = 0; y < rows; ++y)
+        {
+            for (unsigned x = 0; x < cols; ++x)
+            {
+                // leave a hole
+                if (x == 1 && y == 1)
+                    continue;
+
+                auto image = Image::create(Image::R8G8B8A8_UNORM, 4, 4);
+                std::memset(image->data<char>(), (int)((x + y * cols) & 0xff), image->sizeInBytes());
+                REQUIRE(writer.write(TileKey(lod, x, y, profile), image, io).ok());
+            }
+        }
+
+        writer.close();
+
+        // back to a single file
+        CHECK(!std::filesystem::exists(path.string() + "-wal"));
+    }
+
+    MBTiles::Driver reader;
+    Profile p;
+    DataExtentList extents;
+    REQUIRE(reader.open("test", options, false, p, extents, io).ok());
+    CHECK(p == profile);
+
+    // many threads reading the same file at once
+    std::atomic<unsigned> good = { 0u }, bad = { 0u };
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&, t]()
+            {
+                for (unsigned i = 0; i < 200; ++i)
+                {
+                    unsigned x = (i * 7 + t) % cols, y = (i * 3 + t) % rows;
+                    auto r = reader.read(TileKey(lod, x, y, profile), io);
+                    if (x == 1 && y == 1)
+                        (r.status.code == Status::ResourceUnavailable ? good : bad)++;
+                    else if (r.status.ok() && r.value->data<unsigned char>()[0] == ((x + y * cols) & 0xff))
+                        good++;
+                    else
+                        bad++;
+                }
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    CHECK(good == 1600);
+    CHECK(bad == 0);
+
+    // past the data
+    auto missing = reader.read(TileKey(lod + 1, 0, 0, profile), io);
+    CHECK(missing.status.code == Status::ResourceUnavailable);
+
+    // tile availability comes from the index
+    TileKey present(lod, 2, 2, profile);
+    CHECK(reader.bestAvailableTileKey(present) == present);
+    CHECK(reader.bestAvailableTileKey(TileKey(lod + 2, 9, 9, profile)) == present);
+    CHECK(reader.bestAvailableTileKey(TileKey(lod, 1, 1, profile)).valid() == false);
+    CHECK(reader.bestAvailableTileKey(TileKey(lod - 1, 0, 0, profile)).valid() == false);
+
+    reader.close();
+    std::filesystem::remove(path);
+}
+#endif // ROCKY_SUPPORTS_MBTILES
+
 #ifdef ROCKY_SUPPORTS_TMS
 TEST_CASE("TMS")
 {
@@ -737,7 +1892,7 @@ TEST_CASE("IO")
         {
             CHECK(r.value.contentType == "text/xml");
 
-            auto body = r.value.data;
+            auto body = r.value.data.str();
             CHECK(!body.empty());
             CHECK(rocky::util::startsWith(body, "<?xml"));
         }
@@ -756,7 +1911,7 @@ TEST_CASE("IO")
             CHECKED_IF(r.status.ok())
             {
                 CHECK(r.value.contentType == "text/xml");
-                auto body = r.value.data;
+                auto body = r.value.data.str();
                 CHECK(!body.empty());
                 CHECK(rocky::util::startsWith(body, "<?xml"));
             }
@@ -767,6 +1922,374 @@ TEST_CASE("IO")
         }
     }
 
+    SECTION("Connection pool")
+    {
+        struct TestConnection : public ConnectionPool::Connection { };
+        auto factory = [](const std::string&) { return std::make_unique<TestConnection>(); };
+
+        ConnectionPool pool;
+        pool.maxConnectionsPerHost = 2;
+        {
+            auto a = pool.acquire("http://a:80", factory);
+            CHECK(a);
+        }
+        CHECK(pool.idle() == 1);
+        {
+            auto a = pool.acquire("http://a:80", factory);
+            auto b = pool.acquire("http://b:80", factory);
+            CHECK((a && b));
+        }
+        CHECK(pool.created == 2);
+        CHECK(pool.reused == 1);
+
+        // at the per-host limit, acquire() blocks until a connection comes back..
+        auto first = pool.acquire("http://a:80", factory);
+        auto second = pool.acquire("http://a:80", factory);
+        std::thread releaser([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                second.release();
+            });
+        auto third = pool.acquire("http://a:80", factory);
+        releaser.join();
+        CHECK(third);
+
+        // ..or until the caller cancels
+        struct Canceled : public Cancelable {
+            bool canceled() const override { return true; }
+        } canceled;
+        auto fourth = pool.acquire("http://a:80", factory, &canceled);
+        CHECK(!fourth);
+
+        // a release wakes a waiter for the same host, even with others waiting for a busy one
+        {
+            ConnectionPool busy;
+            busy.maxConnectionsPerHost = 1;
+            auto held_a = busy.acquire("http://a:80", factory);
+            auto held_b = busy.acquire("http://b:80", factory);
+
+            std::atomic_bool stop = { false };
+            struct Stop : public Cancelable {
+                std::atomic_bool* flag;
+                bool canceled() const override { return *flag; }
+            } stopper;
+            stopper.flag = &stop;
+
+            std::vector<std::thread> a_waiters;
+            for (int i = 0; i < 4; ++i)
+                a_waiters.emplace_back([&]() { busy.acquire("http://a:80", factory, &stopper); });
+
+            std::chrono::steady_clock::time_point released;
+            std::thread b_waiter([&]() {
+                auto lease = busy.acquire("http://b:80", factory);
+                CHECK(lease);
+                CHECK(std::chrono::steady_clock::now() - released < std::chrono::milliseconds(90));
+            });
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            released = std::chrono::steady_clock::now();
+            held_b.release();
+            b_waiter.join();
+
+            stop = true;
+            for (auto& t : a_waiters)
+                t.join();
+        }
+
+        // a discarded connection is closed, not pooled
+        third.discard();
+        third.release();
+        first.release();
+        CHECK(pool.idle() == 2);
+
+        // idle connections expire
+        pool.idleTimeout = std::chrono::milliseconds(10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto fresh = pool.acquire("http://a:80", factory);
+        CHECK(pool.idle() == 0);
+        CHECK(pool.created == 4);
+
+        // closing a connection happens outside the pool's lock, so a slow
+        // close doesn't stall everyone else (or deadlock one that calls back in)
+        struct CallbackConnection : public ConnectionPool::Connection {
+            ConnectionPool* pool = nullptr;
+            std::atomic_int* closed = nullptr;
+            ~CallbackConnection() { pool->idle(); ++(*closed); }
+        };
+        ConnectionPool callbacks;
+        std::atomic_int closed = { 0 };
+        auto callback_factory = [&](const std::string&) {
+            auto c = std::make_unique<CallbackConnection>();
+            c->pool = &callbacks;
+            c->closed = &closed;
+            return c;
+        };
+        callbacks.acquire("http://c:80", callback_factory).release();
+        callbacks.idleTimeout = std::chrono::milliseconds(10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        callbacks.acquire("http://c:80", callback_factory).release(); // expires the first
+        CHECK(closed == 1);
+        callbacks.clear();
+        CHECK(closed == 2);
+    }
+
+#ifdef HTTPLIB_FOUND
+    SECTION("HTTP keep-alive")
+    {
+        // local stand-in for a tile server that records the client port of each request
+        httplib::Server server;
+        std::mutex ports_mutex;
+        std::set<int> ports;
+        server.Get(R"(/tiles/(\d+))", [&](const httplib::Request& req, httplib::Response& res) {
+                std::scoped_lock L(ports_mutex);
+                ports.insert(req.remote_port);
+                res.set_content(req.matches[1].str(), "text/plain");
+            });
+
+        int port = server.bind_to_any_port("127.0.0.1");
+        std::thread listener([&]() { server.listen_after_bind(); });
+        while (!server.is_running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        IOOptions io;
+        for (int i = 0; i < 5; ++i)
+        {
+            URI uri("http://127.0.0.1:" + std::to_string(port) + "/tiles/" + std::to_string(i));
+            auto r = uri.read(io);
+            CHECK(r.status.ok());
+            CHECK(r.value.data == std::to_string(i));
+        }
+
+        // every request went over the same socket
+        CHECK(ports.size() == 1);
+        CHECK(io.services().connectionPool->created == 1);
+        CHECK(io.services().connectionPool->reused == 4);
+
+        server.stop();
+        listener.join();
+    }
+
+    SECTION("HTTP revalidation")
+    {
+        // server whose content must be revalidated on every read; its 304s carry
+        // no freshness headers, which must not make the cached copy fresh for good
+        httplib::Server server;
+        std::atomic_int full = { 0 }, not_modified = { 0 };
+        server.Get("/data", [&](const httplib::Request& req, httplib::Response& res) {
+                res.set_header("ETag", "\"v1\"");
+                if (req.get_header_value("If-None-Match") == "\"v1\"")
+                {
+                    res.status = 304;
+                    ++not_modified;
+                }
+                else
+                {
+                    res.set_header("Cache-Control", "max-age=0");
+                    res.set_content("payload", "text/plain");
+                    ++full;
+                }
+            });
+
+        int port = server.bind_to_any_port("127.0.0.1");
+        std::thread listener([&]() { server.listen_after_bind(); });
+        while (!server.is_running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        IOOptions io;
+        URI uri("http://127.0.0.1:" + std::to_string(port) + "/data");
+        for (int i = 0; i < 3; ++i)
+        {
+            auto r = uri.read(io);
+            REQUIRE(r.status.ok());
+            CHECK(r.value.data == "payload");
+            CHECK(r.value.etag == "\"v1\"");
+        }
+
+        // downloaded once, then confirmed twice without a body
+        CHECK(full == 1);
+        CHECK(not_modified == 2);
+
+        server.stop();
+        listener.join();
+    }
+
+    SECTION("HTTP throttling")
+    {
+        // server that throttles the first request and tracks how many run at once
+        httplib::Server server;
+        std::atomic_int requests = { 0 }, active = { 0 }, most_active = { 0 };
+        server.Get(R"(/tiles/(\d+))", [&](const httplib::Request& req, httplib::Response& res) {
+                if (requests++ == 0)
+                {
+                    res.status = 429;
+                    res.set_header("Retry-After", "1");
+                    return;
+                }
+                int now = ++active;
+                for (int m = most_active; now > m && !most_active.compare_exchange_weak(m, now); );
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                --active;
+                res.set_content(req.matches[1].str(), "text/plain");
+            });
+
+        int port = server.bind_to_any_port("127.0.0.1");
+        std::thread listener([&]() { server.listen_after_bind(); });
+        while (!server.is_running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        auto base = "http://127.0.0.1:" + std::to_string(port) + "/tiles/";
+
+        // the 429 is retried after the server's Retry-After delay
+        IOOptions io;
+        util::timer timer;
+        auto r = URI(base + "0").read(io);
+        REQUIRE(r.status.ok());
+        CHECK(r.value.data == "0");
+        CHECK(requests == 2);
+        CHECK(timer.seconds() >= 0.9);
+
+        // no more than two requests in flight at once
+        io.maxRequestsPerHost = 2;
+        std::vector<std::thread> readers;
+        std::atomic_int ok = { 0 };
+        for (int i = 1; i <= 8; ++i)
+        {
+            readers.emplace_back([&, i]() {
+                    if (URI(base + std::to_string(i)).read(io).status.ok())
+                        ++ok;
+                });
+        }
+        for (auto& reader : readers)
+            reader.join();
+
+        CHECK(ok == 8);
+        CHECK(most_active <= 2);
+
+        server.stop();
+        listener.join();
+    }
+
+    SECTION("HTTP compression")
+    {
+        std::string text;
+        for (int i = 0; i < 1000; ++i)
+            text += "<TileMap version=\"1.0.0\"/>\n";
+
+        std::ostringstream gzipped;
+        REQUIRE(util::ZLibCompressor().compress(text, gzipped));
+
+        std::ostringstream deflated, zstd;
+        REQUIRE(util::ZLibCompressor(1024u * 1024u, true).compress(text, deflated));
+        if (util::ZStdCompressor::available())
+            REQUIRE(util::ZStdCompressor().compress(text, zstd));
+
+        // server that compresses when the client says it can decode
+        httplib::Server server;
+        server.Get("/tilemap.xml", [&](const httplib::Request& req, httplib::Response& res) {
+                if (req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos)
+                {
+                    res.set_header("Content-Encoding", "gzip");
+                    res.set_content(gzipped.str(), "text/xml");
+                }
+                else
+                {
+                    res.set_content(text, "text/xml");
+                }
+            });
+        server.Get("/raw.xml", [&](const httplib::Request&, httplib::Response& res) {
+                res.set_header("Content-Encoding", "deflate");
+                res.set_content(deflated.str(), "text/xml");
+            });
+        std::string accepted;
+        server.Get("/zstd.xml", [&](const httplib::Request& req, httplib::Response& res) {
+                accepted = req.get_header_value("Accept-Encoding");
+                res.set_header("Content-Encoding", "zstd");
+                res.set_content(zstd.str(), "text/xml");
+            });
+
+        int port = server.bind_to_any_port("127.0.0.1");
+        std::thread listener([&]() { server.listen_after_bind(); });
+        while (!server.is_running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        IOOptions io;
+        auto r = URI("http://127.0.0.1:" + std::to_string(port) + "/tilemap.xml").read(io);
+        REQUIRE(r.status.ok());
+        CHECK(r.value.data == text);
+
+        auto& stats = *io.services().networkStats;
+        CHECK(stats.responses == 1);
+        CHECK(stats.bytesTransferred == gzipped.str().size());
+        CHECK(stats.bytesDecoded == text.size());
+
+        // "deflate" from servers that leave out the zlib header, and zstd if we have it
+        r = URI("http://127.0.0.1:" + std::to_string(port) + "/raw.xml").read(io);
+        REQUIRE(r.status.ok());
+        CHECK(r.value.data == text);
+
+        if (util::ZStdCompressor::available())
+        {
+            r = URI("http://127.0.0.1:" + std::to_string(port) + "/zstd.xml").read(io);
+            REQUIRE(r.status.ok());
+            CHECK(r.value.data == text);
+            CHECK(accepted.find("zstd") != std::string::npos);
+        }
+
+        server.stop();
+        listener.join();
+    }
+#endif
+
+    SECTION("Rate limiter")
+    {
+        RateLimiter limiter;
+
+        // a one-second burst goes out at once, the rest at the limited rate
+        util::timer timer;
+        for (int i = 0; i < 30; ++i)
+            CHECK(limiter.acquire("host", 20.0));
+        CHECK(timer.seconds() >= 0.4);
+
+        // a pause holds back even unlimited requests to that host only
+        limiter.pause("host", RateLimiter::Clock::now() + std::chrono::milliseconds(200));
+        timer = {};
+        CHECK(limiter.acquire("other", 0.0));
+        CHECK(timer.seconds() < 0.1);
+        CHECK(limiter.acquire("host", 0.0));
+        CHECK(timer.seconds() >= 0.15);
+    }
+
+    SECTION("Local files")
+    {
+        // binary content, one small file that's read and one large file that's mapped
+        for (std::size_t size : { std::size_t(100), std::size_t(200 * 1024) })
+        {
+            std::string data(size, '\0');
+            for (std::size_t i = 0; i < size; ++i)
+                data[i] = "ab\r\n\0"[i % 5];
+
+            auto path = std::filesystem::temp_directory_path() / ("rocky_test_local_" + std::to_string(size) + ".bin");
+            {
+                std::ofstream out(path, std::ios_base::out | std::ios_base::binary);
+                out.write(data.data(), data.size());
+            }
+
+            auto r = URI(path.string()).read(IOOptions());
+            REQUIRE(r.status.ok());
+            CHECK(r.value.data.size() == size);
+            CHECK(r.value.data == data);
+
+            // stream over the buffer without copying it
+            ByteBufferStream in(r.value.data);
+            in.seekg(0, std::ios_base::end);
+            CHECK((std::size_t)in.tellg() == size);
+            in.seekg(3);
+            CHECK(in.get() == '\n');
+
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
     SECTION("URI")
     {
         URI file("C:/folder/filename.ext");
@@ -799,6 +2322,305 @@ TEST_CASE("IO")
     }
 }
 
+TEST_CASE("FileCache")
+{
+    auto root = std::filesystem::temp_directory_path() / "rocky_test_cache";
+    std::filesystem::remove_all(root);
+
+    auto cache = FileCache::create(root.string());
+    CHECK(std::filesystem::exists(root));
+
+    auto missing = cache->read("bin", "0/0/0");
+    CHECK(missing.status.code == Status::ResourceUnavailable);
+
+    std::string data("binary\0data\n", 12);
+    CHECK(cache->write("bin", "0/0/0", data).ok());
+    auto r = cache->read("bin", "0/0/0");
+    REQUIRE(r.status.ok());
+    CHECK(r.value.data == data);
+    CHECK(r.value.lastModified > 0);
+
+    // the timestamp alone, without the data
+    auto stamp = cache->stat("bin", "0/0/0");
+    REQUIRE(stamp.status.ok());
+    CHECK(stamp.value == r.value.lastModified);
+    CHECK(cache->stat("bin", "1/0/0").status.code == Status::ResourceUnavailable);
+
+    // a fresh record is not expired; one older than the max age is
+    CachePolicy policy;
+    policy.maxAge = Duration(1, Units::HOURS);
+    CHECK(policy.isExpired(r.value.lastModified) == false);
+    CHECK(policy.isExpired(r.value.lastModified - 7200) == true);
+
+    // keys can't escape the cache folder
+    CHECK(cache->write("bin", "../../escape", data).ok());
+    CHECK(std::filesystem::exists(root / "bin" / "_" / "_" / "escape"));
+
+    CHECK(cache->remove("bin", "0/0/0").ok());
+    CHECK(cache->read("bin", "0/0/0").status.failed());
+
+    CHECK(cache->clear("bin").ok());
+    CHECK(!std::filesystem::exists(root / "bin"));
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE("ContentCache")
+{
+    SECTION("Budget and eviction")
+    {
+        // single shard so eviction order is exact
+        util::ShardedLRUCache<std::string, std::string> cache(10, [](auto& k, auto& v) { return v.size(); }, 1);
+        cache.put("a", "1234");
+        cache.put("b", "1234");
+        CHECK(cache.get("a") == "1234"); // "a" is now the most recent
+        cache.put("c", "1234");          // over budget, evicts "b"
+        CHECK(cache.get("b").empty());
+        CHECK(cache.get("a") == "1234");
+        CHECK(cache.get("c") == "1234");
+
+        // too big to ever fit
+        cache.put("d", "12345678901");
+        CHECK(cache.get("d").empty());
+
+        auto stats = cache.stats();
+        CHECK(stats.gets == 5);
+        CHECK(stats.hits == 3);
+        CHECK(stats.puts == 4);
+        CHECK(stats.evictions == 1);
+        CHECK(stats.entries == 2);
+        CHECK(stats.cost == 8);
+
+        cache.setBudget(4);
+        CHECK(cache.stats().entries == 1);
+        cache.clear();
+        CHECK(cache.stats().cost == 0);
+    }
+
+    SECTION("Handles")
+    {
+        util::ShardedLRUCache<int, std::string> cache(1, nullptr, 1);
+        cache.put(1, "one");
+        auto handle = cache.find(1);
+        REQUIRE(handle != nullptr);
+        cache.put(2, "two"); // evicts 1, but the handle keeps the value alive
+        CHECK(cache.find(1) == nullptr);
+        CHECK(*handle == "one");
+    }
+
+    SECTION("Budget smaller than the shard count")
+    {
+        // like a small elevation L2 cache: every entry must still be usable
+        util::ShardedLRUCache<int, std::string> cache(3, nullptr, 4);
+        for (int i = 0; i < 3; ++i)
+            cache.put(i, std::to_string(i));
+        CHECK(cache.stats().entries == 3);
+
+        // growing and shrinking moves entries between shards without losing them
+        cache.setBudget(32);
+        for (int i = 0; i < 3; ++i)
+            CHECK(cache.get(i) == std::to_string(i));
+        for (int i = 3; i < 32; ++i)
+            cache.put(i, std::to_string(i));
+        CHECK(cache.stats().entries == 32);
+
+        cache.setBudget(2);
+        CHECK(cache.stats().entries == 2);
+        unsigned found = 0;
+        for (int i = 0; i < 32; ++i)
+            if (cache.find(i)) ++found;
+        CHECK(found == 2);
+
+        cache.setBudget(1);
+        cache.put(100, "x");
+        CHECK(cache.get(100) == "x");
+        CHECK(cache.stats().entries == 1);
+    }
+
+    SECTION("Concurrent use")
+    {
+        ContentCache cache(64 * 1024);
+        Content content;
+        content.data = std::string(1000, 'x');
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&cache, &content, t]()
+                {
+                    for (int i = 0; i < 2000; ++i)
+                    {
+                        auto key = std::to_string((i * 7 + t) % 200);
+                        if (!cache.get(key).status.ok())
+                            cache.put(key, content);
+                    }
+                });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        auto stats = cache.stats();
+        CHECK(stats.gets == 8000);
+        CHECK(stats.hits + stats.puts == 8000);
+        CHECK(stats.evictions > 0);
+        CHECK(stats.cost <= cache.budget());
+    }
+}
+
+TEST_CASE("LRU cache contention benchmark", "[.][benchmark]")
+{
+    // Many threads reading a hot working set, with occasional writes,
+    // as when neighboring tiles are sampled for normal maps.
+    const unsigned threads = std::max(util::getConcurrency(), 2u);
+    const int keys = 256, iterations = 200000;
+
+    auto run = [&](auto& cache, auto read)
+        {
+            for (int k = 0; k < keys; ++k)
+                cache.put(k, Result<std::string>(std::string(1024, 'x')));
+
+            util::timer timer;
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&cache, read, t, keys, iterations]()
+                    {
+                        for (int i = 0; i < iterations; ++i)
+                        {
+                            int k = (i * 31 + (int)t) % keys;
+                            if (i % 100 == 0)
+                                cache.put(k, Result<std::string>(std::string(1024, 'y')));
+                            else
+                                read(cache, k);
+                        }
+                    });
+            }
+            for (auto& worker : workers)
+                worker.join();
+            return timer.milliseconds();
+        };
+
+    util::LRUCache<int, Result<std::string>> lru(keys * 2);
+    auto lru_ms = run(lru, [](auto& c, int k) { return c.get(k).status.ok(); });
+
+    util::ShardedLRUCache<int, Result<std::string>> sharded(keys * 2);
+    auto sharded_ms = run(sharded, [](auto& c, int k) { return c.find(k) != nullptr; });
+
+    std::cout << threads << " threads"
+        << " lru=" << lru_ms << "ms"
+        << " sharded=" << sharded_ms << "ms"
+        << " speedup=" << lru_ms / sharded_ms << "x"
+        << std::endl;
+}
+
+TEST_CASE("IOTracer")
+{
+    auto tracer = IOTracer::create();
+    IOOptions io;
+    io.services().tracer = tracer;
+
+    SECTION("Scopes")
+    {
+        // no tracer, no record
+        CHECK(IOTracer::current() == nullptr);
+        {
+            IOTracer::Scope scope(IOOptions(), "layer", "0/0/0");
+            CHECK(IOTracer::current() == nullptr);
+        }
+
+        {
+            IOTracer::Scope outer(io, "imagery", "1/0/0");
+            REQUIRE(IOTracer::current() != nullptr);
+            IOTracer::current()->host = "http://a.server";
+            IOTracer::current()->requests++;
+            IOTracer::current()->cacheMisses++;
+            IOTracer::current()->time[IOTracer::FIRST_BYTE] += std::chrono::milliseconds(30);
+            {
+                IOTracer::Scope inner(io, "elevation", "1/0/0");
+                IOTracer::current()->cacheHits++;
+            }
+            // back to the outer record
+            CHECK(IOTracer::current()->layer == "imagery");
+        }
+        CHECK(IOTracer::current() == nullptr);
+
+        auto records = tracer->records();
+        REQUIRE(records.size() == 2);
+        CHECK(records[0].layer == "elevation");
+        CHECK(records[0].cacheHits == 1);
+        CHECK(records[1].layer == "imagery");
+        CHECK(records[1].requests == 1);
+        CHECK(records[1].time[IOTracer::TOTAL] >= records[0].time[IOTracer::TOTAL]);
+
+        auto layers = tracer->byLayer();
+        CHECK(layers.size() == 2);
+        CHECK(layers["imagery"].count == 1);
+        CHECK(layers["imagery"].cacheMisses == 1);
+        CHECK(layers["imagery"].time[IOTracer::FIRST_BYTE].mean() == Approx(30.0));
+
+        auto hosts = tracer->byHost();
+        REQUIRE(hosts.size() == 1);
+        CHECK(hosts.begin()->first == "http://a.server");
+
+        auto csv = tracer->toCSV();
+        CHECK(util::startsWith(csv, "layer,name,host,start_ms,queue_ms"));
+        CHECK(std::count(csv.begin(), csv.end(), '\n') == 3);
+
+        auto trace = json::parse(tracer->toChromeTrace());
+        CHECK(trace["traceEvents"].size() == 2);
+
+        tracer->clear();
+        CHECK(tracer->records().empty());
+        CHECK(tracer->byLayer().empty());
+    }
+
+    SECTION("Histogram")
+    {
+        IOTracer::Histogram h;
+        for (int i = 0; i < 90; ++i) h.add(3.0);
+        for (int i = 0; i < 10; ++i) h.add(150.0);
+        CHECK(h.count == 100);
+        CHECK(h.percentile(0.5) == 5.0);
+        CHECK(h.percentile(0.95) == 150.0); // capped at the max seen
+        CHECK(h.max == 150.0);
+        CHECK(h.mean() == Approx(17.7));
+    }
+
+    SECTION("Queue wait")
+    {
+        util::job_scheduler::setConcurrency("test.tracer", 1);
+        auto scheduler = util::job_scheduler::get("test.tracer");
+
+        util::Event started, release;
+        auto blocker = util::job::dispatch([&](Cancelable&) {
+                started.set();
+                release.wait();
+                return true;
+            }, { "blocker", nullptr, scheduler });
+
+        started.wait();
+
+        auto waited = util::job::dispatch([&](Cancelable&) {
+                IOTracer::Scope scope(io, "queued", "0/0/0");
+                {
+                    IOTracer::Scope nested(io, "nested", "0/0/0");
+                }
+                return true;
+            }, { "queued", nullptr, scheduler });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release.set();
+        waited.join();
+
+        // only the job's first scope counts its queue wait
+        auto records = tracer->records();
+        REQUIRE(records.size() == 2);
+        CHECK(records[0].layer == "nested");
+        CHECK(records[0].time[IOTracer::QUEUE] == IOTracer::Clock::duration(0));
+        CHECK(records[1].time[IOTracer::QUEUE] >= std::chrono::milliseconds(15));
+    }
+}
+
 TEST_CASE("Earth File")
 {
     EarthFileImporter importer;